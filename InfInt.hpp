@@ -8,6 +8,7 @@
 #include <vector>
 #include <limits>
 #include <exception>
+#include <cstdint>
 
 // C std lib
 #include <cmath>
@@ -48,11 +49,19 @@ public:
 	std::string str(void) const;
 	template <class T> T to_int(void) const;
 	template <class T> T to_int_safe(void) const;
+	template <class T> std::vector<T> to_words(void) const; // |*this|, least significant word first
+	template <class T> static InfInt from_words(const std::vector<T>& words); // inverse of to_words, non negative
+	template <class T> InfInt& assign_words(const std::vector<T>& words); // same as from_words, in the current storage
 	// 2 in 1 operator //
 	static InfIntFullDivResult fulldiv(const InfInt& a, const InfInt& b);
+	// exact division //
+	static InfInt divexact(const InfInt& a, const InfInt& b); // b must divide a
+	static bool divisible_by(const InfInt& a, const InfInt& b);
+	static std::uint32_t word_inverse(std::uint32_t odd); // odd^-1 mod 2^32
 	// operator //
 	// equal
 	InfInt& operator=(const InfInt& other);
+	InfInt& operator=(InfInt&& other);
 	// cmp
 	bool operator==(const InfInt& other) const;
 	bool operator!=(const InfInt& other) const;
@@ -99,6 +108,7 @@ public:
 	static const InfInt pos_one;
 protected:
 	InfInt& clean(void);
+	static bool hensel_divide(const InfInt& a, const InfInt& b, InfInt& quotient);
 	// Attributes //
 	std::vector<bool> m_number;
 	bool m_sign;
@@ -127,6 +137,36 @@ T InfInt::to_int_safe(void) const {
 	return tmp;
 }
 
+template <class T>
+std::vector<T> InfInt::to_words(void) const {
+	size_type bits_in_T = sizeof(T) * 8;
+	InfInt tmp(*this);
+	if (tmp.sign())
+		tmp.twos_complement();
+	std::vector<T> words((tmp.size() + bits_in_T - 1) / bits_in_T, 0);
+	for (size_type i = 0; i < tmp.size(); ++i)
+		if (tmp.m_number[i])
+			words[i / bits_in_T] |= static_cast<T>(1) << (i % bits_in_T);
+	return words;
+}
+
+template <class T>
+InfInt InfInt::from_words(const std::vector<T>& words) {
+	InfInt tmp;
+	tmp.assign_words(words);
+	return tmp;
+}
+
+template <class T>
+InfInt& InfInt::assign_words(const std::vector<T>& words) {
+	size_type bits_in_T = sizeof(T) * 8;
+	this->m_sign = false;
+	this->m_number.resize(words.size() * bits_in_T);
+	for (size_type i = 0; i < this->m_number.size(); ++i)
+		this->m_number[i] = (words[i / bits_in_T] >> (i % bits_in_T)) & 1;
+	return this->clean();
+}
+
 // Outside the class //
 
 InfInt operator "" _infint(unsigned long long other); // alows the use of the macro _infint to transform a unsigned long long to an InfInt
@@ -501,12 +541,100 @@ InfIntFullDivResult InfInt::fulldiv(const InfInt& _a, const InfInt& _b) {
 	return InfIntFullDivResult(quotient, remainder);
 }
 
+InfInt InfInt::divexact(const InfInt& a, const InfInt& b) {
+	if (b == InfInt::zero)
+		throw std::domain_error("static InfInt InfInt::divexact(const InfInt& a, const InfInt& b): Cannot divide by 0");
+	InfInt quotient;
+	InfInt::hensel_divide(a, b, quotient);
+	return quotient;
+}
+
+bool InfInt::divisible_by(const InfInt& a, const InfInt& b) {
+	if (b == InfInt::zero)
+		return a == InfInt::zero;
+	InfInt quotient;
+	return InfInt::hensel_divide(a, b, quotient);
+}
+
+// Newton's iteration doubles the correct low bits of the inverse: 1 is
+// right modulo 2 for any odd word, five steps reach 32 bits
+std::uint32_t InfInt::word_inverse(std::uint32_t odd) {
+	std::uint32_t inverse = 1;
+	for (int i = 0; i < 5; ++i)
+		inverse *= 2 - odd * inverse;
+	return inverse;
+}
+
+// Jebelean's exact division: once the common powers of two are gone b is
+// odd, and each 32 bits word of the quotient is the low word of what is
+// left of a times b^-1 mod 2^32, with no comparison or correction. The
+// quotient is a / b when b divides a, and the returned flag tells whether
+// it does: only then is nothing left of a at the end
+bool InfInt::hensel_divide(const InfInt& a, const InfInt& b, InfInt& quotient) {
+	size_type shift = 0;
+	while (!b.get(shift))
+		++shift;
+	InfInt abs_a(a);
+	if (abs_a.sign())
+		abs_a.twos_complement();
+	InfInt abs_b(b);
+	if (abs_b.sign())
+		abs_b.twos_complement();
+	bool exact = true;
+	for (size_type i = 0; i < shift && exact; ++i)
+		exact = !abs_a.get(i);
+
+	std::vector<std::uint32_t> rest = (abs_a >> shift).to_words<std::uint32_t>();
+	std::vector<std::uint32_t> divisor = (abs_b >> shift).to_words<std::uint32_t>();
+	if (rest.size() < divisor.size()) {
+		quotient = InfInt::zero;
+		return exact && abs_a == InfInt::zero;
+	}
+
+	std::uint32_t inverse = InfInt::word_inverse(divisor[0]);
+
+	std::vector<std::uint32_t> words(rest.size() - divisor.size() + 1);
+	rest.push_back(0);
+	for (std::size_t i = 0; i < words.size(); ++i) {
+		std::uint32_t q = rest[i] * inverse;
+		words[i] = q;
+		std::uint64_t carry = 0;
+		std::uint32_t borrow = 0;
+		for (std::size_t j = 0; i + j < rest.size(); ++j) {
+			if (j >= divisor.size() && carry == 0 && borrow == 0)
+				break;
+			std::uint64_t p = (j < divisor.size() ? static_cast<std::uint64_t>(q) * divisor[j] : 0) + carry;
+			carry = p >> 32;
+			std::uint64_t s = static_cast<std::uint32_t>(p) + static_cast<std::uint64_t>(borrow);
+			borrow = rest[i + j] < s;
+			rest[i + j] = static_cast<std::uint32_t>(rest[i + j] - s);
+		}
+	}
+	for (std::size_t i = words.size(); i < rest.size() && exact; ++i)
+		exact = rest[i] == 0;
+
+	quotient = InfInt::from_words(words);
+	if (a.sign() != b.sign() && quotient != InfInt::zero)
+		quotient.twos_complement();
+	return exact;
+}
+
 InfInt& InfInt::operator=(const InfInt& other) {
 	this->m_sign = other.sign();
 	this->m_number = other.m_number;
 	return *this;
 }
 
+InfInt& InfInt::operator=(InfInt&& other) {
+	if (this == &other)
+		return *this;
+	this->m_sign = other.m_sign;
+	this->m_number = std::move(other.m_number);
+	other.m_number = {0};
+	other.m_sign = false;
+	return *this;
+}
+
 bool InfInt::operator==(const InfInt& other) const {
 	if (this->size() != other.size())
 		return false;
@@ -0,0 +1,151 @@
+#ifndef INFINTCRT_HPP
+#define INFINTCRT_HPP
+
+// std libs
+#include <vector>
+#include <span>
+#include <thread>
+#include <stdexcept>
+#include <string>
+
+// InfInt libs
+#include "InfInt.hpp"
+#include "InfIntMath.hpp"
+#include "InfModInt.hpp"
+
+// Chinese remainder reconstruction for a fixed set of pairwise coprime
+// moduli; everything that only depends on the moduli is computed once
+class InfIntCRT {
+public:
+	enum Mode {
+		garner, // mixed radix, quadratic but with small constants
+		tree // linear combination summed up the product tree
+	};
+
+	InfIntCRT(const std::vector<InfInt>& moduli, Mode mode = tree);
+	~InfIntCRT(void);
+
+	Mode mode(void) const;
+	const std::vector<InfInt>& moduli(void) const;
+	const InfInt& modulus(void) const; // product of the moduli
+
+	InfInt reconstruct(std::span<const InfInt> residues) const; // in [0, modulus())
+	std::vector<InfInt> reconstruct(std::span<const std::vector<InfInt>> residues, unsigned threads = std::thread::hardware_concurrency()) const;
+	std::vector<InfInt> residues(const InfInt& x) const;
+protected:
+	InfInt reconstruct_garner(std::span<const InfInt> residues) const;
+	InfInt reconstruct_tree(std::span<const InfInt> residues) const;
+
+	Mode m_mode;
+	InfIntMath::ProductTree m_tree;
+	std::vector<InfModInt> m_inverses; // garner: (m_0 ... m_i-1)^-1 mod m_i, tree: (M / m_i)^-1 mod m_i, each with the context of its m_i
+	std::vector<InfInt> m_prefix; // garner: m_0 ... m_i-1
+};
+
+
+
+InfIntCRT::InfIntCRT(const std::vector<InfInt>& moduli, Mode mode):
+	m_mode(mode),
+	m_tree(InfIntMath::product_tree(moduli))
+{
+	if (moduli.empty())
+		throw std::invalid_argument("InfIntCRT::InfIntCRT(const std::vector<InfInt>& moduli, Mode mode): needs at least one modulus");
+	for (const InfInt& m : moduli)
+		if (m <= InfInt::zero)
+			throw std::invalid_argument("InfIntCRT::InfIntCRT(const std::vector<InfInt>& moduli, Mode mode): moduli must be positive (m=" + m.str() + ")");
+
+	this->m_inverses.reserve(moduli.size());
+	try {
+		if (this->m_mode == garner) {
+			this->m_prefix.reserve(moduli.size());
+			InfInt prefix = InfInt::pos_one;
+			for (std::size_t i = 0; i < moduli.size(); ++i) {
+				this->m_prefix.push_back(prefix);
+				this->m_inverses.emplace_back(InfIntMath::modinv(prefix % moduli[i], moduli[i]), moduli[i]);
+				prefix *= moduli[i];
+			}
+		} else {
+			// (M mod m_i^2) / m_i = (M / m_i) mod m_i for every i from one descent
+			std::vector<InfInt> cofactors(moduli.size());
+			InfIntMath::remainder_tree(this->m_tree, this->modulus(), cofactors, true);
+			for (std::size_t i = 0; i < moduli.size(); ++i)
+				this->m_inverses.emplace_back(InfIntMath::modinv(InfInt::divexact(cofactors[i], moduli[i]), moduli[i]), moduli[i]);
+		}
+	} catch (const std::domain_error&) {
+		throw std::invalid_argument("InfIntCRT::InfIntCRT(const std::vector<InfInt>& moduli, Mode mode): moduli must be pairwise coprime");
+	}
+}
+
+InfIntCRT::~InfIntCRT(void) {
+	//
+}
+
+InfIntCRT::Mode InfIntCRT::mode(void) const {
+	return this->m_mode;
+}
+
+const std::vector<InfInt>& InfIntCRT::moduli(void) const {
+	return this->m_tree.front();
+}
+
+const InfInt& InfIntCRT::modulus(void) const {
+	return this->m_tree.back()[0];
+}
+
+InfInt InfIntCRT::reconstruct(std::span<const InfInt> residues) const {
+	if (residues.size() != this->m_inverses.size())
+		throw std::invalid_argument("InfInt InfIntCRT::reconstruct(std::span<const InfInt> residues) const: expected " + std::to_string(this->m_inverses.size()) + " residues, got " + std::to_string(residues.size()));
+	return this->m_mode == garner ? this->reconstruct_garner(residues) : this->reconstruct_tree(residues);
+}
+
+std::vector<InfInt> InfIntCRT::reconstruct(std::span<const std::vector<InfInt>> residues, unsigned threads) const {
+	std::vector<InfInt> values(residues.size());
+	InfIntMath::parallel_chunks(residues.size(), 1, threads, [&](std::size_t begin, std::size_t end) {
+		for (std::size_t i = begin; i < end; ++i)
+			values[i] = this->reconstruct(residues[i]);
+	});
+	return values;
+}
+
+std::vector<InfInt> InfIntCRT::residues(const InfInt& x) const {
+	std::vector<InfInt> residues(this->m_inverses.size());
+	InfIntMath::remainder_tree(this->m_tree, x, residues);
+	return residues;
+}
+
+// x = v_0 + v_1 m_0 + v_2 m_0 m_1 + ..., each digit v_i fixed by the residue
+// modulo m_i of the part already built; the digits are worked out in the
+// context of m_i, which reduces x a word block at a time
+InfInt InfIntCRT::reconstruct_garner(std::span<const InfInt> residues) const {
+	const std::vector<InfInt>& moduli = this->moduli();
+	InfInt x = InfIntMath::modulo(residues[0], moduli[0]);
+	for (std::size_t i = 1; i < moduli.size(); ++i) {
+		const InfModInt::Context& context = this->m_inverses[i].context();
+		InfModInt v = (InfModInt(residues[i], context) - InfModInt(x, context)) * this->m_inverses[i];
+		x += v.value() * this->m_prefix[i];
+	}
+	return x;
+}
+
+// x = sum (r_i c_i mod m_i) M / m_i with c_i = (M / m_i)^-1 mod m_i; each node
+// combines its children as left * right_product + right * left_product
+InfInt InfIntCRT::reconstruct_tree(std::span<const InfInt> residues) const {
+	const std::vector<InfInt>& moduli = this->moduli();
+	std::vector<InfInt> level(moduli.size());
+	for (std::size_t i = 0; i < moduli.size(); ++i)
+		level[i] = (InfModInt(residues[i], this->m_inverses[i].context()) * this->m_inverses[i]).value();
+
+	for (std::size_t l = 0; l + 1 < this->m_tree.size(); ++l) {
+		const std::vector<InfInt>& products = this->m_tree[l];
+		std::vector<InfInt> next;
+		next.reserve((level.size() + 1) / 2);
+		for (std::size_t i = 0; i + 1 < level.size(); i += 2)
+			next.push_back(level[i] * products[i + 1] + level[i + 1] * products[i]);
+		if (level.size() % 2 != 0)
+			next.push_back(std::move(level.back()));
+		level = std::move(next);
+	}
+	return level[0] % this->modulus();
+}
+
+#endif // INFINTCRT_HPP
@@ -4,12 +4,29 @@
 // C++ std
 #include <string>
 #include <stdexcept>
+#include <cstdint>
+#include <bit>
+#include <utility>
+#include <array>
+#include <vector>
+#include <span>
+#include <thread>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <cmath>
+#include <map>
 
 // InfInt libs
 #include "InfInt.hpp"
 #include "InfIntResult.hpp"
 #include "InfIntRandom.hpp"
 
+class InfModInt;
+
 namespace InfIntMath {
 
 InfInt abs(const InfInt& infint);
@@ -22,134 +39,179 @@ InfInt& max(InfInt& a, InfInt& b);
 
 InfInt pow(const InfInt& _a, const InfInt& _b);
 InfInt modpow(const InfInt& _a, const InfInt& _b, const InfInt& m);
+InfInt modpow_ladder(const InfInt& _a, const InfInt& _b, const InfInt& m); // same number of steps whatever the bits of _b
+InfInt modpow_window(const InfInt& _a, const InfInt& _b, const InfInt& m); // same, fixed windows, close to modpow's cost
+InfModInt pow(const InfModInt& a, const InfInt& b);
 
 InfInt sqrt(const InfInt& n);
+InfIntSqrtremResult sqrtrem(const InfInt& n); // n = root^2 + remainder
+bool is_perfect_square(const InfInt& n);
 InfInt root(const InfInt& a, const InfInt& b);
+InfInt nth_root(const InfInt& a, unsigned long k); // floor of the k-th root
+bool is_perfect_power(const InfInt& _n); // n = m^k for some k >= 2
 
 InfInt log2(const InfInt& a);
-InfInt log(const InfInt& a, const InfInt& b);
+InfInt log(const InfInt& a, const InfInt& b); // floor, same as ilog
+InfInt::size_type ilog(const InfInt& n, const InfInt& base); // largest e with base^e <= n
+double log2_double(const InfInt& n); // from the leading 53 bits
 
 InfInt modulo(const InfInt& a, const InfInt& b);
 
+// operands above this many bits go through hgcd_reduce in gcd, egcd and modinv;
+// the recursion only pays off once multiplication is subquadratic, so the
+// default is kept high while operator* is schoolbook. Tests pass a lower
+// threshold to reach the recursion on small operands
+constexpr InfInt::size_type hgcd_threshold = 1 << 16;
+
 InfInt lcm(const InfInt& a, const InfInt& b);
-InfInt gcd(const InfInt& _a, const InfInt& _b);
-InfIntEGCDResult egcd(const InfInt& a, const InfInt& b);
-InfInt modinv(const InfInt& a, const InfInt& b);
+InfInt gcd(const InfInt& _a, const InfInt& _b, InfInt::size_type threshold = hgcd_threshold);
+std::uint64_t binary_gcd(std::uint64_t a, std::uint64_t b);
+InfIntEGCDResult egcd(const InfInt& a, const InfInt& b, InfInt::size_type threshold = hgcd_threshold);
+InfInt modinv(const InfInt& a, const InfInt& b, InfInt::size_type threshold = hgcd_threshold);
+
+// Montgomery's trick: one modinv and 3(n-1) products for the whole span
+InfIntBatchModinvResult batch_modinv(std::span<const InfInt> values, const InfInt& m);
+void batch_modinv(std::span<const InfInt> values, const InfInt& m, std::span<InfInt> inverses, std::vector<std::size_t>& failed);
+InfIntBatchModinvResult batch_modinv_parallel(std::span<const InfInt> values, const InfInt& m, unsigned threads = std::thread::hardware_concurrency());
+
+// Lehmer: 2x2 matrix of Euclid steps simulated on the leading machine words
+typedef std::array<long long, 4> LehmerMatrix; // {A, B, C, D}
+bool lehmer_matrix(const InfInt& a, const InfInt& b, LehmerMatrix& w);
+void lehmer_apply(InfInt& u, InfInt& v, const LehmerMatrix& w);
+
+// half-gcd: (a', b') = M (a, b) with b' about half the size of a
+typedef std::array<InfInt, 4> CofactorMatrix; // {m00, m01, m10, m11}
+InfIntHGCDResult hgcd(const InfInt& a, const InfInt& b, InfInt::size_type threshold = hgcd_threshold);
+CofactorMatrix hgcd_reduce(InfInt& a, InfInt& b, InfInt::size_type threshold = hgcd_threshold);
+CofactorMatrix hgcd_mul(const CofactorMatrix& s, const CofactorMatrix& r);
+void hgcd_apply(InfInt& a, InfInt& b, CofactorMatrix& r);
+void hgcd_step(InfInt& a, InfInt& b, CofactorMatrix& r);
 
 bool congruent_modulo(const InfInt& a, const InfInt& b, const InfInt& n);
 bool coprime(const InfInt& a, const InfInt& b);
 
-bool probable_prime_base(const InfInt& n, const InfInt& a);
-bool probable_prime(const InfInt& n);
+// residue of |n| from its 32 bits words, in machine arithmetic
+std::uint32_t mod_small(const std::vector<std::uint32_t>& words, std::uint32_t m);
+std::uint32_t mod_small(const InfInt& n, std::uint32_t m);
+
+const std::uint32_t small_primes_limit = 1 << 16;
+std::uint32_t trial_division(const InfInt& n, std::uint32_t bound = small_primes_limit); // smallest prime factor below bound, 0 if none
+
+int jacobi(const InfInt& a, const InfInt& n);
+
+bool probable_prime_base(const InfInt& n, const InfInt& a); // strong probable prime (Miller-Rabin) to base a
+bool strong_lucas_probable_prime(const InfInt& n); // Selfridge's parameters
+bool probable_prime(const InfInt& n); // Baillie-PSW
+bool miller_rabin(const InfInt& n, unsigned rounds); // deterministic below 2^64
+
+// prime generation: candidates are sieved by the small primes a window at
+// a time and only the survivors reach the strong tests
+const std::size_t prime_window = 2048;
+void sieve_window(const InfInt& start, std::vector<bool>& composite);
+InfInt next_prime(const InfInt& n); // smallest prime > n
+InfInt prime_in_window(const InfInt& start, const InfInt& limit, std::vector<bool>& composite, const std::function<bool(void)>& stop = nullptr); // zero if none
+InfInt random_prime(InfInt::size_type bits, InfIntRandomEngine& engine, InfInt::size_type top = 1); // prime of exactly bits bits, the top ones set
+
+// the windows are drawn from one stream seeded with seed and the sieve
+// survivors of each are split among the threads; the lowest one that passes
+// wins, so the result is random_prime's for that stream whatever threads is
+InfInt parallel_random_prime(InfInt::size_type bits, unsigned threads, InfIntRandomEngine::result_type seed, InfInt::size_type top = 1);
+InfInt parallel_random_prime(InfInt::size_type bits, unsigned threads = std::thread::hardware_concurrency());
+std::vector<std::uint32_t> primes_up_to(std::uint32_t n);
+
+// balanced product trees: the multiplications get operands of the same size
+InfInt product(std::span<const InfInt> values);
+InfInt product(std::span<const std::uint32_t> factors); // packed into words first
+InfInt factorial(std::uint32_t n); // prime swing
+InfInt binomial(std::uint32_t n, std::uint32_t k);
+InfInt primorial(std::uint32_t n); // product of the primes <= n
+
+// runs f(begin, end) on the chunks of [0, size), taken from an atomic index;
+// an exception thrown by f is rethrown to the caller
+void parallel_chunks(std::size_t size, std::size_t chunk, unsigned threads, const std::function<void(std::size_t, std::size_t)>& f);
+
+// Bernstein's trees: levels[0] holds the values and each level above the
+// products of pairs from the one below. Trees are built tree_chunk values at
+// a time so that memory stays proportional to one chunk per thread
+typedef std::vector<std::vector<InfInt>> ProductTree;
+const std::size_t tree_chunk = 1024;
+ProductTree product_tree(std::span<const InfInt> values);
+void remainder_tree(const ProductTree& tree, const InfInt& x, std::span<InfInt> remainders, bool squared = false); // x mod each leaf (squared)
+std::vector<InfInt> chunk_products(std::span<const InfInt> values, unsigned threads = std::thread::hardware_concurrency());
+std::vector<InfInt> remainder_tree(const InfInt& x, std::span<const InfInt> moduli, std::span<const InfInt> products, unsigned threads, bool squared);
+std::vector<InfInt> remainder_tree(const InfInt& x, std::span<const InfInt> moduli, unsigned threads = std::thread::hardware_concurrency());
+std::vector<InfInt> batch_gcd(std::span<const InfInt> values, unsigned threads = std::thread::hardware_concurrency()); // gcd of each value with the product of the others
+
+// factorisation: trial division, then Pollard-Brent rho, then Lenstra's ECM
+// with increasing bounds; the finders return a nontrivial factor or zero
+const std::size_t rho_steps = 1 << 14;
+InfInt pollard_brent(const InfInt& n, const InfInt& c, std::size_t max_steps = rho_steps);
+
+// x-only arithmetic on the Montgomery curve By^2 = x^3 + Ax^2 + x modulo n,
+// with a24 = (A + 2) / 4 and the points as (X : Z)
+typedef std::array<InfModInt, 2> MontgomeryPoint; // {X, Z}
+MontgomeryPoint ecm_double(const MontgomeryPoint& p, const InfModInt& a24);
+MontgomeryPoint ecm_add(const MontgomeryPoint& p, const MontgomeryPoint& q, const MontgomeryPoint& diff); // diff = p - q
+MontgomeryPoint ecm_multiply(const MontgomeryPoint& p, std::uint64_t k, const InfModInt& a24);
+InfInt ecm_curve(const InfInt& n, const InfInt& sigma, std::uint32_t B1, const std::vector<std::uint32_t>& primes, const std::function<bool(void)>& stop = nullptr); // Suyama's curve, stage 2 up to primes.back()
+InfInt ecm(const InfInt& n, std::uint32_t B1, unsigned curves, unsigned threads = std::thread::hardware_concurrency());
+
+InfInt find_factor(const InfInt& n, unsigned threads = std::thread::hardware_concurrency()); // n composite, not a perfect power
+std::map<InfInt, unsigned> factor(const InfInt& n, unsigned threads = std::thread::hardware_concurrency()); // prime -> exponent, -1 for negative n
 
 } // namesapce InfIntMath
 
+// InfModInt needs the declarations above and the definitions below need it
+#include "InfModInt.hpp"
+
 
 
 namespace InfIntMath {
 
-const std::vector<InfInt> first_primes = {
-	2, 3, 5, 7, 11, 13, 17, 19, 23, 29,
-	31, 37, 41, 43, 47, 53, 59, 61, 67, 71,
-	73, 79, 83, 89, 97, 101, 103, 107, 109, 113,
-	127, 131, 137, 139, 149, 151, 157, 163, 167, 173,
-	179, 181, 191, 193, 197, 199, 211, 223, 227, 229,
-	233, 239, 241, 251, 257, 263, 269, 271, 277, 281,
-	283, 293, 307, 311, 313, 317, 331, 337, 347, 349,
-	353, 359, 367, 373, 379, 383, 389, 397, 401, 409,
-	419, 421, 431, 433, 439, 443, 449, 457, 461, 463,
-	467, 479, 487, 491, 499, 503, 509, 521, 523, 541,
-	547, 557, 563, 569, 571, 577, 587, 593, 599, 601,
-	607, 613, 617, 619, 631, 641, 643, 647, 653, 659,
-	661, 673, 677, 683, 691, 701, 709, 719, 727, 733,
-	739, 743, 751, 757, 761, 769, 773, 787, 797, 809,
-	811, 821, 823, 827, 829, 839, 853, 857, 859, 863,
-	877, 881, 883, 887, 907, 911, 919, 929, 937, 941,
-	947, 953, 967, 971, 977, 983, 991, 997, 1009, 1013,
-	1019, 1021, 1031, 1033, 1039, 1049, 1051, 1061, 1063, 1069,
-	1087, 1091, 1093, 1097, 1103, 1109, 1117, 1123, 1129, 1151,
-	1153, 1163, 1171, 1181, 1187, 1193, 1201, 1213, 1217, 1223,
-	1229, 1231, 1237, 1249, 1259, 1277, 1279, 1283, 1289, 1291,
-	1297, 1301, 1303, 1307, 1319, 1321, 1327, 1361, 1367, 1373,
-	1381, 1399, 1409, 1423, 1427, 1429, 1433, 1439, 1447, 1451,
-	1453, 1459, 1471, 1481, 1483, 1487, 1489, 1493, 1499, 1511,
-	1523, 1531, 1543, 1549, 1553, 1559, 1567, 1571, 1579, 1583,
-	1597, 1601, 1607, 1609, 1613, 1619, 1621, 1627, 1637, 1657,
-	1663, 1667, 1669, 1693, 1697, 1699, 1709, 1721, 1723, 1733,
-	1741, 1747, 1753, 1759, 1777, 1783, 1787, 1789, 1801, 1811,
-	1823, 1831, 1847, 1861, 1867, 1871, 1873, 1877, 1879, 1889,
-	1901, 1907, 1913, 1931, 1933, 1949, 1951, 1973, 1979, 1987,
-	1993, 1997, 1999, 2003, 2011, 2017, 2027, 2029, 2039, 2053,
-	2063, 2069, 2081, 2083, 2087, 2089, 2099, 2111, 2113, 2129,
-	2131, 2137, 2141, 2143, 2153, 2161, 2179, 2203, 2207, 2213,
-	2221, 2237, 2239, 2243, 2251, 2267, 2269, 2273, 2281, 2287,
-	2293, 2297, 2309, 2311, 2333, 2339, 2341, 2347, 2351, 2357,
-	2371, 2377, 2381, 2383, 2389, 2393, 2399, 2411, 2417, 2423,
-	2437, 2441, 2447, 2459, 2467, 2473, 2477, 2503, 2521, 2531,
-	2539, 2543, 2549, 2551, 2557, 2579, 2591, 2593, 2609, 2617,
-	2621, 2633, 2647, 2657, 2659, 2663, 2671, 2677, 2683, 2687,
-	2689, 2693, 2699, 2707, 2711, 2713, 2719, 2729, 2731, 2741,
-	2749, 2753, 2767, 2777, 2789, 2791, 2797, 2801, 2803, 2819,
-	2833, 2837, 2843, 2851, 2857, 2861, 2879, 2887, 2897, 2903,
-	2909, 2917, 2927, 2939, 2953, 2957, 2963, 2969, 2971, 2999,
-	3001, 3011, 3019, 3023, 3037, 3041, 3049, 3061, 3067, 3079,
-	3083, 3089, 3109, 3119, 3121, 3137, 3163, 3167, 3169, 3181,
-	3187, 3191, 3203, 3209, 3217, 3221, 3229, 3251, 3253, 3257,
-	3259, 3271, 3299, 3301, 3307, 3313, 3319, 3323, 3329, 3331,
-	3343, 3347, 3359, 3361, 3371, 3373, 3389, 3391, 3407, 3413,
-	3433, 3449, 3457, 3461, 3463, 3467, 3469, 3491, 3499, 3511,
-	3517, 3527, 3529, 3533, 3539, 3541, 3547, 3557, 3559, 3571,
-	3581, 3583, 3593, 3607, 3613, 3617, 3623, 3631, 3637, 3643,
-	3659, 3671, 3673, 3677, 3691, 3697, 3701, 3709, 3719, 3727,
-	3733, 3739, 3761, 3767, 3769, 3779, 3793, 3797, 3803, 3821,
-	3823, 3833, 3847, 3851, 3853, 3863, 3877, 3881, 3889, 3907,
-	3911, 3917, 3919, 3923, 3929, 3931, 3943, 3947, 3967, 3989,
-	4001, 4003, 4007, 4013, 4019, 4021, 4027, 4049, 4051, 4057,
-	4073, 4079, 4091, 4093, 4099, 4111, 4127, 4129, 4133, 4139,
-	4153, 4157, 4159, 4177, 4201, 4211, 4217, 4219, 4229, 4231,
-	4241, 4243, 4253, 4259, 4261, 4271, 4273, 4283, 4289, 4297,
-	4327, 4337, 4339, 4349, 4357, 4363, 4373, 4391, 4397, 4409,
-	4421, 4423, 4441, 4447, 4451, 4457, 4463, 4481, 4483, 4493,
-	4507, 4513, 4517, 4519, 4523, 4547, 4549, 4561, 4567, 4583,
-	4591, 4597, 4603, 4621, 4637, 4639, 4643, 4649, 4651, 4657,
-	4663, 4673, 4679, 4691, 4703, 4721, 4723, 4729, 4733, 4751,
-	4759, 4783, 4787, 4789, 4793, 4799, 4801, 4813, 4817, 4831,
-	4861, 4871, 4877, 4889, 4903, 4909, 4919, 4931, 4933, 4937,
-	4943, 4951, 4957, 4967, 4969, 4973, 4987, 4993, 4999, 5003,
-	5009, 5011, 5021, 5023, 5039, 5051, 5059, 5077, 5081, 5087,
-	5099, 5101, 5107, 5113, 5119, 5147, 5153, 5167, 5171, 5179,
-	5189, 5197, 5209, 5227, 5231, 5233, 5237, 5261, 5273, 5279,
-	5281, 5297, 5303, 5309, 5323, 5333, 5347, 5351, 5381, 5387,
-	5393, 5399, 5407, 5413, 5417, 5419, 5431, 5437, 5441, 5443,
-	5449, 5471, 5477, 5479, 5483, 5501, 5503, 5507, 5519, 5521,
-	5527, 5531, 5557, 5563, 5569, 5573, 5581, 5591, 5623, 5639,
-	5641, 5647, 5651, 5653, 5657, 5659, 5669, 5683, 5689, 5693,
-	5701, 5711, 5717, 5737, 5741, 5743, 5749, 5779, 5783, 5791,
-	5801, 5807, 5813, 5821, 5827, 5839, 5843, 5849, 5851, 5857,
-	5861, 5867, 5869, 5879, 5881, 5897, 5903, 5923, 5927, 5939,
-	5953, 5981, 5987, 6007, 6011, 6029, 6037, 6043, 6047, 6053,
-	6067, 6073, 6079, 6089, 6091, 6101, 6113, 6121, 6131, 6133,
-	6143, 6151, 6163, 6173, 6197, 6199, 6203, 6211, 6217, 6221,
-	6229, 6247, 6257, 6263, 6269, 6271, 6277, 6287, 6299, 6301,
-	6311, 6317, 6323, 6329, 6337, 6343, 6353, 6359, 6361, 6367,
-	6373, 6379, 6389, 6397, 6421, 6427, 6449, 6451, 6469, 6473,
-	6481, 6491, 6521, 6529, 6547, 6551, 6553, 6563, 6569, 6571,
-	6577, 6581, 6599, 6607, 6619, 6637, 6653, 6659, 6661, 6673,
-	6679, 6689, 6691, 6701, 6703, 6709, 6719, 6733, 6737, 6761,
-	6763, 6779, 6781, 6791, 6793, 6803, 6823, 6827, 6829, 6833,
-	6841, 6857, 6863, 6869, 6871, 6883, 6899, 6907, 6911, 6917,
-	6947, 6949, 6959, 6961, 6967, 6971, 6977, 6983, 6991, 6997,
-	7001, 7013, 7019, 7027, 7039, 7043, 7057, 7069, 7079, 7103,
-	7109, 7121, 7127, 7129, 7151, 7159, 7177, 7187, 7193, 7207,
-	7211, 7213, 7219, 7229, 7237, 7243, 7247, 7253, 7283, 7297,
-	7307, 7309, 7321, 7331, 7333, 7349, 7351, 7369, 7393, 7411,
-	7417, 7433, 7451, 7457, 7459, 7477, 7481, 7487, 7489, 7499,
-	7507, 7517, 7523, 7529, 7537, 7541, 7547, 7549, 7559, 7561,
-	7573, 7577, 7583, 7589, 7591, 7603, 7607, 7621, 7639, 7643,
-	7649, 7669, 7673, 7681, 7687, 7691, 7699, 7703, 7717, 7723,
-	7727, 7741, 7753, 7757, 7759, 7789, 7793, 7817, 7823, 7829,
-	7841, 7853, 7867, 7873, 7877, 7879, 7883, 7901, 7907, 7919
-};
+// sieve of the odd numbers below Limit, composite[i] is about 2 * i + 1
+template <std::uint32_t Limit>
+constexpr std::array<bool, Limit / 2> sieve_odd_below(void) {
+	std::array<bool, Limit / 2> composite{};
+	composite[0] = true;
+	for (std::uint32_t i = 1; 2 * i * (i + 1) < Limit / 2; ++i)
+		if (!composite[i])
+			for (std::uint32_t j = 2 * i * (i + 1); j < Limit / 2; j += 2 * i + 1)
+				composite[j] = true;
+	return composite;
+}
+
+// squares modulo M, to reject non squares without computing a root
+template <std::uint32_t M>
+constexpr std::array<bool, M> squares_modulo(void) {
+	std::array<bool, M> square{};
+	for (std::uint32_t i = 0; i < M; ++i)
+		square[i * i % M] = true;
+	return square;
+}
+
+template <std::uint32_t Limit>
+constexpr std::size_t count_primes_below(void) {
+	constexpr std::array<bool, Limit / 2> composite = sieve_odd_below<Limit>();
+	std::size_t count = 1;
+	for (bool c : composite)
+		count += !c;
+	return count;
+}
+
+template <std::uint32_t Limit>
+constexpr std::array<std::uint32_t, count_primes_below<Limit>()> make_primes_below(void) {
+	constexpr std::array<bool, Limit / 2> composite = sieve_odd_below<Limit>();
+	std::array<std::uint32_t, count_primes_below<Limit>()> primes{};
+	primes[0] = 2;
+	std::size_t count = 1;
+	for (std::uint32_t i = 1; i < Limit / 2; ++i)
+		if (!composite[i])
+			primes[count++] = 2 * i + 1;
+	return primes;
+}
+
+// every prime below small_primes_limit, sieved at compile time
+constexpr auto small_primes = make_primes_below<small_primes_limit>();
 
 InfInt abs(const InfInt& infint) {
 	InfInt tmp(infint);
@@ -214,69 +276,197 @@ InfInt pow(const InfInt& _a, const InfInt& _b) {
 	return r;
 }
 
-InfInt modpow(const InfInt& _a, const InfInt& _b, const InfInt& m) {
+// the checks and the sign handling shared by the modpow variants; name is
+// the caller, for the messages, and power the InfModInt exponentiation. The
+// residues stay in a Montgomery or Barrett context of |m|; the sign follows
+// the truncating %, so a negative _a gives a result <= 0 for odd _b
+InfInt modpow_with(const InfInt& _a, const InfInt& _b, const InfInt& m, const std::string& name, InfModInt (InfModInt::*power)(const InfInt&) const) {
 	if (_b == InfInt::zero) {
 		if (_a == InfInt::zero)
-			throw std::domain_error("InfInt InfIntMath::modpow(const InfInt& _a, const InfInt& _b, const InfInt& m): Division by zero");
+			throw std::domain_error("InfInt InfIntMath::" + name + "(const InfInt& _a, const InfInt& _b, const InfInt& m): Division by zero");
 		return InfInt::pos_one;
 	}
 	if (_b < InfInt::zero) {
 		if (_a == InfInt::zero)
-			throw std::domain_error("InfInt InfIntMath::modpow(const InfInt& _a, const InfInt& _b, const InfInt& m): Division by zero");
+			throw std::domain_error("InfInt InfIntMath::" + name + "(const InfInt& _a, const InfInt& _b, const InfInt& m): Division by zero");
 		return InfInt::zero;
 	}
+	if (m == InfInt::zero)
+		throw std::domain_error("InfInt InfIntMath::" + name + "(const InfInt& _a, const InfInt& _b, const InfInt& m): Cannot divide by 0");
 
-	InfInt a(_a);
-	InfInt b(_b);
-	InfInt r(InfInt::pos_one);
+	InfInt r = (InfModInt(abs(_a), abs(m)).*power)(_b).value();
+	if (_a.sign() && _b.get(0))
+		r.twos_complement();
+	return r;
+}
 
-	while (b.size() != 1) {
-		if (b.get(0))
-			r = r * a % m;
-		a = a * a % m;
-		b >>= 1;
-	}
-	if (b.get(0))
-		r = r * a % m;
+InfInt modpow(const InfInt& _a, const InfInt& _b, const InfInt& m) {
+	return modpow_with(_a, _b, m, "modpow", &InfModInt::pow);
+}
 
-	return r;
+// see InfModInt::pow_ladder
+InfInt modpow_ladder(const InfInt& _a, const InfInt& _b, const InfInt& m) {
+	return modpow_with(_a, _b, m, "modpow_ladder", &InfModInt::pow_ladder);
+}
+
+// see InfModInt::pow_window
+InfInt modpow_window(const InfInt& _a, const InfInt& _b, const InfInt& m) {
+	return modpow_with(_a, _b, m, "modpow_window", &InfModInt::pow_window);
 }
 
+InfModInt pow(const InfModInt& a, const InfInt& b) {
+	return a.pow(b);
+}
+
+// Newton's iteration from 2^ceil(bits/2) >= sqrt(n) decreases strictly
+// until it reaches floor(sqrt(n)), so it needs no correction step
 InfInt sqrt(const InfInt& n) {
 	if (n < InfInt::zero)
 		throw std::domain_error("InfInt sqrt(const InfInt& n): must have n >= 0 (n=" + n.str() + ")");
-	InfInt x = n;
-	InfInt old_x;
-	while (old_x != x) {
-		old_x = x;
-		x = x - ( x * x - n ) / ( 2_infint * x );
+	if (n == InfInt::zero)
+		return InfInt::zero;
+
+	if (n.size() <= 64) {
+		std::uint64_t v = n.to_int<std::uint64_t>();
+		std::uint64_t x = std::uint64_t(1) << ((n.size() + 1) / 2);
+		for (std::uint64_t y = (x + v / x) >> 1; y < x; y = (x + v / x) >> 1)
+			x = y;
+		return InfInt(x);
 	}
-	if (x * x > n) --x;
+
+	InfInt x = InfInt::pos_one << ((n.size() + 1) / 2);
+	for (InfInt y = (x + n / x) >> 1; y < x; y = (x + n / x) >> 1)
+		x = std::move(y);
 	return x;
 }
 
+InfIntSqrtremResult sqrtrem(const InfInt& n) {
+	InfInt root = sqrt(n);
+	return InfIntSqrtremResult(root, n - root * root);
+}
+
+bool is_perfect_square(const InfInt& n) {
+	static constexpr std::array<bool, 64> squares_64 = squares_modulo<64>();
+	static constexpr std::array<bool, 63> squares_63 = squares_modulo<63>();
+	static constexpr std::array<bool, 65> squares_65 = squares_modulo<65>();
+	static constexpr std::array<bool, 11> squares_11 = squares_modulo<11>();
+	if (n < InfInt::zero)
+		return false;
+	// 64 * 63 * 65 * 11 fits in a word: one residue serves the four filters,
+	// which let through less than 1% of the non squares
+	std::uint32_t r = mod_small(n, 64 * 63 * 65 * 11);
+	if (!squares_64[r % 64] || !squares_63[r % 63] || !squares_65[r % 65] || !squares_11[r % 11])
+		return false;
+	return sqrtrem(n).remainder() == InfInt::zero;
+}
+
 InfInt root(const InfInt& a, const InfInt& b) {
 	if (a < InfInt::zero)
 		throw std::domain_error("InfInt root(const InfInt& a, const InfInt& b): must have a >= 0 (a=" + a.str() + ")");
-	InfInt x = InfInt::pos_one;
-	InfInt old_x;
-	while (old_x != x) {
-		old_x = x;
-		InfInt f = pow(x, b) - a;
-		InfInt _f = b * pow(x, b - InfInt::pos_one);
-		x -= f / _f;
-	}
-	while (pow(x, b) > a)
-		--x;
-	return x;
+	if (b <= InfInt::zero)
+		throw std::domain_error("InfInt root(const InfInt& a, const InfInt& b): must have b > 0 (b=" + b.str() + ")");
+	// any root of order >= a.size() is 0 or 1, so b can be clamped to a word
+	return nth_root(a, b < InfInt(a.size()) ? b.to_int<unsigned long>() : a.size());
+}
+
+// same iteration as sqrt: x = ((k - 1) x + a / x^(k-1)) / k from
+// 2^ceil(bits/k), which is above the root, decreases down to the floor
+InfInt nth_root(const InfInt& a, unsigned long k) {
+	if (a < InfInt::zero)
+		throw std::domain_error("InfInt InfIntMath::nth_root(const InfInt& a, unsigned long k): must have a >= 0 (a=" + a.str() + ")");
+	if (k == 0)
+		throw std::domain_error("InfInt InfIntMath::nth_root(const InfInt& a, unsigned long k): must have k > 0");
+	if (k == 1 || a <= InfInt::pos_one)
+		return a;
+	if (k == 2)
+		return sqrt(a);
+	if (k >= a.size())
+		return InfInt::pos_one;
+
+	InfInt big_k(k);
+	InfInt k_1(k - 1);
+	InfInt x = InfInt::pos_one << ((a.size() + k - 1) / k);
+	while (true) {
+		InfInt y = (k_1 * x + a / pow(x, k_1)) / big_k;
+		if (y >= x)
+			return x;
+		x = std::move(y);
+	}
+}
+
+// only prime exponents need checking, up to log2 n; when n is even the
+// exponent must also divide the number of trailing zeros
+bool is_perfect_power(const InfInt& _n) {
+	if (abs(_n) <= InfInt::pos_one)
+		return true;
+	InfInt n = abs(_n);
+	InfInt::size_type zeros = 0;
+	while (!n.get(zeros))
+		++zeros;
+
+	for (InfInt::size_type p = 2; p < n.size(); p = next_prime(InfInt(p)).to_int<InfInt::size_type>()) {
+		if (zeros != 0 && zeros % p != 0)
+			continue;
+		if (p == 2) {
+			// negative numbers are only odd powers
+			if (_n > InfInt::zero && is_perfect_square(n))
+				return true;
+			continue;
+		}
+		if (pow(nth_root(n, p), InfInt(p)) == n)
+			return true;
+	}
+	return false;
 }
 
 InfInt log2(const InfInt& a) {
+	if (a <= InfInt::zero)
+		throw std::domain_error("InfInt InfIntMath::log2(const InfInt& a): must have a > 0 (a=" + a.str() + ")");
 	return a.size() - 1;
 }
 
 InfInt log(const InfInt& a, const InfInt& b) {
-	return log2(a) / log2(b);
+	return InfInt(ilog(a, b));
+}
+
+// base^(2^i) by repeated squaring while it stays <= n, then the exponent is
+// read from the most significant bit down, as in a binary search
+InfInt::size_type ilog(const InfInt& n, const InfInt& base) {
+	if (n <= InfInt::zero)
+		throw std::domain_error("InfInt::size_type InfIntMath::ilog(const InfInt& n, const InfInt& base): must have n > 0 (n=" + n.str() + ")");
+	if (base <= InfInt::pos_one)
+		throw std::domain_error("InfInt::size_type InfIntMath::ilog(const InfInt& n, const InfInt& base): must have base > 1 (base=" + base.str() + ")");
+
+	// a power of two base only needs the bit length of n
+	InfInt::size_type base_bits = base.size() - 1;
+	if (base == InfInt::pos_one << base_bits)
+		return (n.size() - 1) / base_bits;
+
+	std::vector<InfInt> powers;
+	for (InfInt power = base; power <= n; power *= power) {
+		powers.push_back(power);
+		if (power.size() > n.size() / 2 + 1)
+			break;
+	}
+
+	InfInt::size_type e = 0;
+	InfInt acc = InfInt::pos_one;
+	for (std::size_t i = powers.size(); i-- > 0;) {
+		InfInt next = acc * powers[i];
+		if (next <= n) {
+			acc = std::move(next);
+			e += InfInt::size_type(1) << i;
+		}
+	}
+	return e;
+}
+
+double log2_double(const InfInt& n) {
+	if (n <= InfInt::zero)
+		throw std::domain_error("double InfIntMath::log2_double(const InfInt& n): must have n > 0 (n=" + n.str() + ")");
+	InfInt::size_type shift = n.size() > 53 ? n.size() - 53 : 0;
+	std::uint64_t top = (shift == 0 ? n : n >> shift).to_int<std::uint64_t>();
+	return std::log2(static_cast<double>(top)) + static_cast<double>(shift);
 }
 
 InfInt modulo(const InfInt& a, const InfInt& b) {
@@ -287,73 +477,383 @@ InfInt modulo(const InfInt& a, const InfInt& b) {
 }
 
 InfInt lcm(const InfInt& a, const InfInt& b) {
-	return a / gcd(a, b) * b;
+	if (a == InfInt::zero || b == InfInt::zero)
+		return InfInt::zero;
+	return InfInt::divexact(a, gcd(a, b)) * b;
 }
 
-InfInt gcd(const InfInt& _a, const InfInt& _b) {
-	InfInt a(_a);
-	InfInt b(_b);
+// Lehmer's gcd: the Euclid quotients are guessed on the leading 62 bits of
+// a and b and only applied to the full numbers once they stop being certain,
+// as a 2x2 matrix of machine words; operands that fit in a word finish with
+// Stein's binary gcd
+InfInt gcd(const InfInt& _a, const InfInt& _b, InfInt::size_type threshold) {
+	InfInt a = abs(_a);
+	InfInt b = abs(_b);
+	if (a < b)
+		std::swap(a, b);
+
+	LehmerMatrix w;
 	while (b != InfInt::zero) {
-		InfInt c = a % b;
-		a = b;
-		b = c;
+		if (a.size() > threshold) {
+			hgcd_reduce(a, b, threshold);
+			if (b != InfInt::zero) {
+				InfInt r = a % b;
+				a = std::move(b);
+				b = std::move(r);
+			}
+		} else if (a.size() <= 64)
+			return InfInt(binary_gcd(a.to_int<std::uint64_t>(), b.to_int<std::uint64_t>()));
+		else if (lehmer_matrix(a, b, w))
+			lehmer_apply(a, b, w);
+		else {
+			// the leading words could not agree on a single quotient
+			InfInt r = a % b;
+			a = std::move(b);
+			b = std::move(r);
+		}
 	}
 	return a;
 }
 
-InfIntEGCDResult egcd(const InfInt& a, const InfInt& b) {
-	InfInt r = b;
-	InfInt old_r = a;
+std::uint64_t binary_gcd(std::uint64_t a, std::uint64_t b) {
+	if (a == 0)
+		return b;
+	if (b == 0)
+		return a;
+	int shift = std::countr_zero(a | b);
+	a >>= std::countr_zero(a);
+	do {
+		b >>= std::countr_zero(b);
+		if (a > b)
+			std::swap(a, b);
+		b -= a;
+	} while (b != 0);
+	return a << shift;
+}
+
+// needs a >= b >= 0, runs Euclid on the leading 62 bits for as long as
+// Knuth's bounds guarantee the quotients match the full numbers'
+bool lehmer_matrix(const InfInt& a, const InfInt& b, LehmerMatrix& w) {
+	InfInt::size_type shift = a.size() > 62 ? a.size() - 62 : 0;
+	long long ah = (a >> shift).to_int<long long>();
+	long long bh = (b >> shift).to_int<long long>();
+	long long A = 1, B = 0, C = 0, D = 1, T, q;
+	while (bh + C != 0 && bh + D != 0) {
+		q = (ah + A) / (bh + C);
+		if (q != (ah + B) / (bh + D))
+			break;
+		T = A - q * C; A = C; C = T;
+		T = B - q * D; B = D; D = T;
+		T = ah - q * bh; ah = bh; bh = T;
+	}
+	w = {A, B, C, D};
+	return B != 0;
+}
+
+// (u, v) = w (u, v)
+void lehmer_apply(InfInt& u, InfInt& v, const LehmerMatrix& w) {
+	InfInt c = u * InfInt(w[0]) + v * InfInt(w[1]);
+	v = u * InfInt(w[2]) + v * InfInt(w[3]);
+	u = std::move(c);
+}
+
+// x and y are reduced with the same steps as gcd, the cofactors of both
+// follow them through the word matrices and the division steps in place
+InfIntEGCDResult egcd(const InfInt& a, const InfInt& b, InfInt::size_type threshold) {
+	InfInt x = abs(a);
+	InfInt y = abs(b);
+	bool swapped = x < y;
+	if (swapped)
+		std::swap(x, y);
+
+	CofactorMatrix m = {InfInt::pos_one, InfInt::zero, InfInt::zero, InfInt::pos_one};
+	LehmerMatrix w;
+	while (y != InfInt::zero) {
+		if (x.size() > threshold) {
+			m = hgcd_mul(hgcd_reduce(x, y, threshold), m);
+			if (y != InfInt::zero)
+				hgcd_step(x, y, m);
+		} else if (lehmer_matrix(x, y, w)) {
+			lehmer_apply(x, y, w);
+			lehmer_apply(m[0], m[2], w);
+			lehmer_apply(m[1], m[3], w);
+		} else
+			hgcd_step(x, y, m);
+	}
 
-	InfInt s = InfInt::zero;
-	InfInt old_s = InfInt::pos_one;
+	if (swapped)
+		std::swap(m[0], m[1]);
+	if (a.sign())
+		m[0].twos_complement();
+	if (b.sign())
+		m[1].twos_complement();
+	return InfIntEGCDResult(x, m[0], m[1]);
+}
 
-	InfInt t = InfInt::pos_one;
-	InfInt old_t = InfInt::zero;
+// inverse of a modulo b in [0, |b|), only the cofactor of a is computed
+InfInt modinv(const InfInt& a, const InfInt& b, InfInt::size_type threshold) {
+	InfInt n = abs(b);
+	InfInt x = n;
+	InfInt y = modulo(a, n);
+	InfInt c0 = InfInt::zero;
+	InfInt c1 = InfInt::pos_one;
+
+	LehmerMatrix w;
+	while (y != InfInt::zero) {
+		if (x.size() > threshold) {
+			CofactorMatrix m = hgcd_reduce(x, y, threshold);
+			if (y != InfInt::zero)
+				hgcd_step(x, y, m);
+			InfInt c = m[0] * c0 + m[1] * c1;
+			c1 = m[2] * c0 + m[3] * c1;
+			c0 = std::move(c);
+		} else if (lehmer_matrix(x, y, w)) {
+			lehmer_apply(x, y, w);
+			lehmer_apply(c0, c1, w);
+		} else {
+			auto result = InfInt::fulldiv(x, y);
+			x = std::move(y);
+			y = result.remainder();
+			InfInt c = c0 - result.quotient() * c1;
+			c0 = std::move(c1);
+			c1 = std::move(c);
+		}
+	}
 
-	while (r != InfInt::zero) {
-		InfInt tmp_r(r), tmp_s(s), tmp_t(t);
-		auto result = InfInt::fulldiv(old_r, r);
+	if (x != InfInt::pos_one)
+		throw std::domain_error("InfInt InfIntMath::modinv(const InfInt& a, const InfInt& b): a is not invertible modulo b");
+	return modulo(c0, n);
+}
+
+InfIntBatchModinvResult batch_modinv(std::span<const InfInt> values, const InfInt& m) {
+	std::vector<InfInt> inverses(values.size());
+	std::vector<std::size_t> failed;
+	batch_modinv(values, m, inverses, failed);
+	return InfIntBatchModinvResult(inverses, failed);
+}
+
+// inverses must be as long as values, indices of values that share a factor
+// with m are appended to failed and their inverse is left untouched. When the
+// full product has no inverse, the products of pairs, pairs of pairs, ... are
+// built modulo m and only the nodes that share a factor with m are searched,
+// which finds every such value with a few gcds each; the prefix products are
+// then redone once from the first of them
+void batch_modinv(std::span<const InfInt> values, const InfInt& m, std::span<InfInt> inverses, std::vector<std::size_t>& failed) {
+	if (inverses.size() != values.size())
+		throw std::invalid_argument("void InfIntMath::batch_modinv(std::span<const InfInt> values, const InfInt& m, std::span<InfInt> inverses, std::vector<std::size_t>& failed): inverses and values must have the same size");
+	if (values.empty())
+		return;
+
+	// the products stay in the form of one shared context, Montgomery's for odd m
+	InfInt n = abs(m);
+	InfModInt::Context context = InfModInt::context(n);
+	InfModInt one(InfInt::pos_one, context);
+	std::vector<InfModInt> reduced;
+	std::vector<InfModInt> prefix(values.size(), one);
+	std::vector<bool> invertible(values.size(), true);
+	reduced.reserve(values.size());
+	for (const InfInt& value : values)
+		reduced.emplace_back(value, context);
+
+	InfModInt product = one;
+	for (std::size_t i = 0; i < values.size(); ++i) {
+		product *= reduced[i];
+		prefix[i] = product;
+	}
+
+	auto result = egcd(product.value(), n);
+	InfModInt inverse(result.x(), context);
+	if (result.gcd() != InfInt::pos_one) {
+		std::vector<std::vector<InfModInt>> tree(1, reduced);
+		while (tree.back().size() > 1) {
+			const std::vector<InfModInt>& below = tree.back();
+			std::vector<InfModInt> level;
+			level.reserve((below.size() + 1) / 2);
+			for (std::size_t i = 0; i + 1 < below.size(); i += 2)
+				level.push_back(below[i] * below[i + 1]);
+			if (below.size() % 2 != 0)
+				level.push_back(below.back());
+			tree.push_back(std::move(level));
+		}
 
-		r = result.remainder();
-		s = old_s - result.quotient() * s;
-		t = old_t - result.quotient() * t;
+		// depth first from the root, left child first, so failed comes out sorted
+		std::vector<std::pair<std::size_t, std::size_t>> pending = {{tree.size() - 1, 0}};
+		std::size_t first_failed = values.size();
+		while (!pending.empty()) {
+			auto [level, index] = pending.back();
+			pending.pop_back();
+			if (gcd(tree[level][index].value(), n) == InfInt::pos_one)
+				continue;
+			if (level == 0) {
+				invertible[index] = false;
+				failed.push_back(index);
+				first_failed = std::min(first_failed, index);
+				continue;
+			}
+			if (2 * index + 1 < tree[level - 1].size())
+				pending.emplace_back(level - 1, 2 * index + 1);
+			pending.emplace_back(level - 1, 2 * index);
+		}
 
-		old_r = tmp_r;
-		old_s = tmp_s;
-		old_t = tmp_t;
+		product = first_failed > 0 ? prefix[first_failed - 1] : one;
+		for (std::size_t i = first_failed; i < values.size(); ++i) {
+			if (invertible[i])
+				product *= reduced[i];
+			prefix[i] = product;
+		}
+		inverse = InfModInt(modinv(product.value(), n), context);
 	}
 
-	/*std::cout
-	<< std::endl
-	<< "EGCD:" << std::endl
-	<< "gdc: " << old_r << std::endl
-	<< "x: " << old_s << std::endl
-	<< "y: " << old_t << std::endl
-	<< std::endl;*/
+	for (std::size_t i = values.size(); i-- > 0;) {
+		if (!invertible[i])
+			continue;
+		inverses[i] = (i > 0 ? inverse * prefix[i - 1] : inverse).value();
+		inverse *= reduced[i];
+	}
+}
 
-	return InfIntEGCDResult(old_r, old_s, old_t);
+// every thread runs Montgomery's trick on its own slice, which costs one
+// modinv per thread instead of one for the whole span
+InfIntBatchModinvResult batch_modinv_parallel(std::span<const InfInt> values, const InfInt& m, unsigned threads) {
+	const std::size_t min_slice = 64;
+	if (threads == 0)
+		threads = 1;
+	if (values.size() / min_slice < threads)
+		threads = static_cast<unsigned>(values.size() / min_slice);
+	if (threads <= 1)
+		return batch_modinv(values, m);
+
+	std::vector<InfInt> inverses(values.size());
+	std::vector<std::vector<std::size_t>> failed(threads);
+	std::vector<std::thread> workers;
+	std::exception_ptr error;
+	std::mutex error_mutex;
+	std::size_t slice = (values.size() + threads - 1) / threads;
+	for (unsigned t = 0; t < threads; ++t) {
+		std::size_t begin = t * slice;
+		std::size_t count = std::min(slice, values.size() - begin);
+		workers.emplace_back([&, t, begin, count]() {
+			try {
+				batch_modinv(values.subspan(begin, count), m, std::span<InfInt>(inverses).subspan(begin, count), failed[t]);
+				for (std::size_t& index : failed[t])
+					index += begin;
+			} catch (...) {
+				std::lock_guard<std::mutex> lock(error_mutex);
+				if (!error)
+					error = std::current_exception();
+			}
+		});
+	}
+	for (std::thread& worker : workers)
+		worker.join();
+	if (error)
+		std::rethrow_exception(error); // the first one, once every slice is done
+
+	std::vector<std::size_t> all_failed;
+	for (const std::vector<std::size_t>& f : failed)
+		all_failed.insert(all_failed.end(), f.begin(), f.end());
+	return InfIntBatchModinvResult(inverses, all_failed);
 }
 
-InfInt modinv(const InfInt& a, const InfInt& b) {
-	InfInt r = b;
-	InfInt old_r = a;
+InfIntHGCDResult hgcd(const InfInt& _a, const InfInt& _b, InfInt::size_type threshold) {
+	InfInt a = abs(_a);
+	InfInt b = abs(_b);
+	bool swapped = a < b;
+	if (swapped)
+		std::swap(a, b);
+	CofactorMatrix m = hgcd_reduce(a, b, threshold);
+	if (swapped) {
+		std::swap(m[0], m[1]);
+		std::swap(m[2], m[3]);
+	}
+	if (_a.sign()) {
+		m[0].twos_complement();
+		m[2].twos_complement();
+	}
+	if (_b.sign()) {
+		m[1].twos_complement();
+		m[3].twos_complement();
+	}
+	return InfIntHGCDResult(a, b, m[0], m[1], m[2], m[3]);
+}
 
-	InfInt s = InfInt::zero;
-	InfInt old_s = InfInt::pos_one;
+// needs a >= b >= 0, reduces both in place until b has at most half the bits
+// a had and returns the matrix that was applied; above threshold the
+// leading halves are reduced recursively and the matrices carried over to
+// the full numbers, so the work is done by a few large multiplications
+// instead of one division per quotient
+CofactorMatrix hgcd_reduce(InfInt& a, InfInt& b, InfInt::size_type threshold) {
+	CofactorMatrix m = {InfInt::pos_one, InfInt::zero, InfInt::zero, InfInt::pos_one};
+	InfInt::size_type half = a.size() / 2 + 1;
+	if (b.size() <= half)
+		return m;
+
+	if (a.size() > threshold) {
+		InfInt::size_type k = a.size() / 2;
+		InfInt a0 = a >> k;
+		InfInt b0 = b >> k;
+		m = hgcd_reduce(a0, b0, threshold);
+		hgcd_apply(a, b, m);
+		if (b.size() > half)
+			hgcd_step(a, b, m);
+		if (b.size() > half && 2 * half > a.size()) {
+			k = 2 * half - a.size();
+			a0 = a >> k;
+			b0 = b >> k;
+			CofactorMatrix s = hgcd_reduce(a0, b0, threshold);
+			hgcd_apply(a, b, s);
+			m = hgcd_mul(s, m);
+		}
+	}
 
-	while (r != InfInt::zero) {
-		InfInt tmp_r(r), tmp_s(s);
-		auto result = InfInt::fulldiv(old_r, r);
+	while (b.size() > half)
+		hgcd_step(a, b, m);
+	return m;
+}
 
-		r = result.remainder();
-		s = old_s - result.quotient() * s;
+CofactorMatrix hgcd_mul(const CofactorMatrix& s, const CofactorMatrix& r) {
+	return {
+		s[0] * r[0] + s[1] * r[2],
+		s[0] * r[1] + s[1] * r[3],
+		s[2] * r[0] + s[3] * r[2],
+		s[2] * r[1] + s[3] * r[3]
+	};
+}
 
-		old_r = tmp_r;
-		old_s = tmp_s;
+// (a, b) = m (a, b); a matrix found on truncated operands can leave the
+// pair negative or out of order, the rows of m are fixed up to match
+void hgcd_apply(InfInt& a, InfInt& b, CofactorMatrix& m) {
+	InfInt c = m[0] * a + m[1] * b;
+	b = m[2] * a + m[3] * b;
+	a = c;
+	if (a.sign()) {
+		a.twos_complement();
+		m[0].twos_complement();
+		m[1].twos_complement();
+	}
+	if (b.sign()) {
+		b.twos_complement();
+		m[2].twos_complement();
+		m[3].twos_complement();
 	}
+	if (a < b) {
+		std::swap(a, b);
+		std::swap(m[0], m[2]);
+		std::swap(m[1], m[3]);
+	}
+}
 
-	return old_s;
+// one Euclid step (a, b) = (b, a - q b), recorded in m
+void hgcd_step(InfInt& a, InfInt& b, CofactorMatrix& m) {
+	auto result = InfInt::fulldiv(a, b);
+	a = b;
+	b = result.remainder();
+	InfInt t = m[0] - result.quotient() * m[2];
+	m[0] = m[2];
+	m[2] = t;
+	t = m[1] - result.quotient() * m[3];
+	m[1] = m[3];
+	m[3] = t;
 }
 
 bool congruent_modulo(const InfInt& a, const InfInt& b, const InfInt& n) {
@@ -362,73 +862,717 @@ bool congruent_modulo(const InfInt& a, const InfInt& b, const InfInt& n) {
 
 bool coprime(const InfInt& a, const InfInt& b) {
 	return gcd(a, b) == InfInt::pos_one;
-	/*if (a == b)
-	return false;
-	if (!a.get(0) && !b.get(0))
-	return false;
-	const InfInt& min(min(a, b));
-	const InfInt two(2);
-	for (InfInt i = 3; i <= min; i += two)
-	if (a % i == 0 && b % i == 0)
-	return false;
-	return true;*/
+}
+
+int jacobi(const InfInt& _a, const InfInt& _n) {
+	if (_n <= InfInt::zero || !_n.get(0))
+		throw std::domain_error("int InfIntMath::jacobi(const InfInt& a, const InfInt& n): n must be odd and positive");
+	InfInt a = modulo(_a, _n);
+	InfInt n = _n;
+	int t = 1;
+	while (a != InfInt::zero) {
+		InfInt::size_type zeros = 0;
+		while (!a.get(zeros))
+			++zeros;
+		a >>= zeros;
+		unsigned n8 = n.to_int<unsigned>() & 7;
+		if (zeros % 2 == 1 && (n8 == 3 || n8 == 5))
+			t = -t;
+		std::swap(a, n);
+		if ((a.to_int<unsigned>() & 3) == 3 && (n.to_int<unsigned>() & 3) == 3)
+			t = -t;
+		a %= n;
+	}
+	return n == InfInt::pos_one ? t : 0;
+}
+
+std::uint32_t mod_small(const std::vector<std::uint32_t>& words, std::uint32_t m) {
+	std::uint64_t r = 0;
+	for (std::size_t i = words.size(); i-- > 0;)
+		r = ((r << 32) | words[i]) % m;
+	return static_cast<std::uint32_t>(r);
+}
+
+std::uint32_t mod_small(const InfInt& n, std::uint32_t m) {
+	return mod_small(n.to_words<std::uint32_t>(), m);
+}
+
+// |n| is cut into words once; consecutive primes are multiplied together as
+// long as the product fits in 32 bits, so each word pass checks several
+// primes at a time and the primes themselves only see a machine residue
+std::uint32_t trial_division(const InfInt& n, std::uint32_t bound) {
+	if (bound > small_primes_limit)
+		throw std::domain_error("std::uint32_t InfIntMath::trial_division(const InfInt& n, std::uint32_t bound): bound must be at most small_primes_limit");
+	std::vector<std::uint32_t> words = n.to_words<std::uint32_t>();
+	std::size_t i = 0;
+	while (i < small_primes.size() && small_primes[i] < bound) {
+		std::size_t first = i;
+		std::uint64_t product = small_primes[i++];
+		while (i < small_primes.size() && small_primes[i] < bound && product * small_primes[i] <= 0xFFFFFFFFull)
+			product *= small_primes[i++];
+		std::uint32_t r = mod_small(words, static_cast<std::uint32_t>(product));
+		for (std::size_t j = first; j < i; ++j)
+			if (r % small_primes[j] == 0)
+				return small_primes[j];
+	}
+	return 0;
 }
 
 bool probable_prime_base(const InfInt& n, const InfInt& a) {
 	InfInt n1 = n - InfInt::pos_one;
 	if (!(InfInt::pos_one < a && a < n1))
-		throw std::domain_error("must have 1 < a < n - 1");
-
-	//std::cout << "n: " << n << std::endl;
-	//std::cout << "a: " << a << std::endl;
+		throw std::domain_error("bool InfIntMath::probable_prime_base(const InfInt& n, const InfInt& a): must have 1 < a < n - 1");
 
+	// n - 1 = d * 2^s
 	InfInt::size_type s = 0;
-	InfInt d;
-	for (InfInt::size_type i = 0; i < n1.size(); ++i) {
-		if (!n1.get(i))
-			continue;
-		s = i;
-		d = n1 >> i;
-		break;
+	while (!n1.get(s))
+		++s;
+	InfInt d = n1 >> s;
+
+	InfModInt::Context context = InfModInt::context(n);
+	InfModInt one(InfInt::pos_one, context);
+	InfModInt minus_one = -one;
+	InfModInt x = InfModInt(a, context).pow(d);
+	if (x == one || x == minus_one)
+		return true;
+	for (InfInt::size_type r = 1; r < s; ++r) {
+		x *= x;
+		if (x == minus_one)
+			return true;
+		if (x == one)
+			return false;
+	}
+	return false;
+}
+
+// n odd, not a perfect square; P = 1 and Q = (1 - D) / 4 with D the first
+// of 5, -7, 9, -11, ... such that (D/n) = -1
+bool strong_lucas_probable_prime(const InfInt& n) {
+	if (n < 3_infint || !n.get(0))
+		return n == 2_infint;
+
+	long long D = 5;
+	for (int tries = 0;; ++tries) {
+		int j = jacobi(InfInt(D), n);
+		if (j == -1)
+			break;
+		if (j == 0 && abs(InfInt(D)) != n)
+			return false;
+		if (tries == 10 && is_perfect_square(n))
+			return false;
+		D = D > 0 ? -D - 2 : -D + 2;
 	}
+	InfInt d_lucas(D);
+	InfInt Q((1 - D) / 4);
 
-	//std::cout << "s: " << s << std::endl;
-	//std::cout << "d: " << d << std::endl;
+	// n + 1 = d * 2^s
+	InfInt n1 = n + InfInt::pos_one;
+	InfInt::size_type s = 0;
+	while (!n1.get(s))
+		++s;
+	InfInt d = n1 >> s;
+
+	// U_1 = 1, V_1 = P = 1, then the doubling and +1 formulas along the bits of d
+	InfModInt::Context context = InfModInt::context(n);
+	InfModInt zero(context);
+	InfModInt half(n1 >> 1, context);
+	InfModInt D_n(d_lucas, context);
+	InfModInt Q_n(Q, context);
+	InfModInt U(InfInt::pos_one, context);
+	InfModInt V(InfInt::pos_one, context);
+	InfModInt Qk = Q_n;
+	for (InfInt::size_type i = d.size() - 1; i-- > 0;) {
+		U *= V;
+		V = V * V - (Qk + Qk);
+		Qk *= Qk;
+		if (d.get(i)) {
+			InfModInt u = (U + V) * half;
+			V = (D_n * U + V) * half;
+			U = std::move(u);
+			Qk *= Q_n;
+		}
+	}
 
-	InfInt result = modpow(a, d, n);
-	if (result == InfInt::pos_one)
+	if (U == zero || V == zero)
 		return true;
-
-	for (InfInt::size_type r = 0; r < s; ++r) {
-		//std::cout << "r: " << r << std::endl;
-		InfInt result = modpow(a, d * (InfInt::pos_one << r), n);
-		if (result == n1)
+	for (InfInt::size_type r = 1; r < s; ++r) {
+		V = V * V - (Qk + Qk);
+		if (V == zero)
 			return true;
+		Qk *= Qk;
 	}
-
 	return false;
 }
 
+// trial division, then a strong test to base 2 and a strong Lucas test:
+// no composite is known to pass both
 bool probable_prime(const InfInt& n) {
-	std::cout << "Testing: " << n << std::endl;
+	if (n < 2_infint)
+		return false;
+	std::uint32_t factor = trial_division(n);
+	if (factor != 0)
+		return n == factor;
+	// no factor below 2^16 left
+	if (n.size() <= 32)
+		return true;
+
+	return probable_prime_base(n, 2_infint) && strong_lucas_probable_prime(n);
+}
 
-	for (unsigned long long i = 0; i < first_primes.size(); ++i) {
-		if (n % first_primes[i] == InfInt::zero) {
-			std::cout << "Div test failed with " << first_primes[i] << std::endl;
+// below 2^64 the first 12 primes as bases make the answer exact, above it
+// every round draws a random base in [2, n - 2]
+bool miller_rabin(const InfInt& n, unsigned rounds) {
+	static const int deterministic_bases[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37};
+	if (n < 2_infint)
+		return false;
+	for (int p : deterministic_bases) {
+		if (n == p)
+			return true;
+		if (n % p == InfInt::zero)
 			return false;
+	}
+
+	if (n.size() <= 64) {
+		for (int p : deterministic_bases)
+			if (!probable_prime_base(n, p))
+				return false;
+		return true;
+	}
+
+	InfIntRandomEngine engine(static_cast<InfIntRandomEngine::result_type>(n.size()));
+	for (unsigned i = 0; i < rounds; ++i)
+		if (!probable_prime_base(n, engine.uniform_range(2_infint, n - 2_infint)))
+			return false;
+	return true;
+}
+
+// composite[j] is set when start + 2 j has a prime factor below
+// small_primes_limit; start must be odd and above the table so that no
+// candidate is itself one of the primes. Each prime needs its residue of
+// start once, then strikes every p-th candidate
+void sieve_window(const InfInt& start, std::vector<bool>& composite) {
+	std::fill(composite.begin(), composite.end(), false);
+	std::vector<std::uint32_t> words = start.to_words<std::uint32_t>();
+	std::size_t i = 1;
+	while (i < small_primes.size()) {
+		std::size_t first = i;
+		std::uint64_t product = small_primes[i++];
+		while (i < small_primes.size() && product * small_primes[i] <= 0xFFFFFFFFull)
+			product *= small_primes[i++];
+		std::uint32_t r = mod_small(words, static_cast<std::uint32_t>(product));
+		for (std::size_t k = first; k < i; ++k) {
+			std::uint64_t p = small_primes[k];
+			// start + 2 j = 0 mod p  <=>  j = -r / 2 mod p
+			std::uint64_t j = (p - r % p) % p * ((p + 1) / 2) % p;
+			for (; j < composite.size(); j += p)
+				composite[j] = true;
 		}
 	}
+}
 
-	std::cout << "Div test up to " << first_primes.back() << std::endl;
+InfInt next_prime(const InfInt& n) {
+	if (n < InfInt(small_primes.back())) {
+		std::uint32_t m = n < 2_infint ? 0 : n.to_int<std::uint32_t>();
+		return InfInt(*std::upper_bound(small_primes.begin(), small_primes.end(), m));
+	}
 
-	if (!probable_prime_base(n, 2))
-		std::cout << "is probable prime base 2" << std::endl;
-	else {
-		std::cout << "is composite" << std::endl;
-		return false;
+	InfInt start = n + InfInt::pos_one;
+	if (!start.get(0))
+		++start;
+	std::vector<bool> composite(prime_window);
+	while (true) {
+		sieve_window(start, composite);
+		for (std::size_t j = 0; j < composite.size(); ++j) {
+			if (composite[j])
+				continue;
+			InfInt candidate = start + InfInt(2 * j);
+			if (candidate.size() <= 32 || (probable_prime_base(candidate, 2_infint) && strong_lucas_probable_prime(candidate)))
+				return candidate;
+		}
+		start += InfInt(2 * prime_window);
 	}
+}
 
-	return true;
+// first sieve survivor start + 2 j below limit that passes the strong tests,
+// zero if there is none; stop is polled before each strong test
+InfInt prime_in_window(const InfInt& start, const InfInt& limit, std::vector<bool>& composite, const std::function<bool(void)>& stop) {
+	sieve_window(start, composite);
+	for (std::size_t j = 0; j < composite.size(); ++j) {
+		if (composite[j])
+			continue;
+		InfInt candidate = start + InfInt(2 * j);
+		if (candidate >= limit || (stop && stop()))
+			break;
+		if (candidate.size() <= 32 || (probable_prime_base(candidate, 2_infint) && strong_lucas_probable_prime(candidate)))
+			return candidate;
+	}
+	return InfInt::zero;
+}
+
+// the search goes up from an odd start with the top bits set, so the prime
+// keeps them; top must stay well below bits for the window to hold primes
+InfInt random_prime(InfInt::size_type bits, InfIntRandomEngine& engine, InfInt::size_type top) {
+	if (bits < 2)
+		throw std::domain_error("InfInt InfIntMath::random_prime(InfInt::size_type bits, InfIntRandomEngine& engine, InfInt::size_type top): must have bits >= 2");
+	if (top == 0 || top >= bits)
+		throw std::domain_error("InfInt InfIntMath::random_prime(InfInt::size_type bits, InfIntRandomEngine& engine, InfInt::size_type top): must have 0 < top < bits (bits=" + std::to_string(bits) + ", top=" + std::to_string(top) + ")");
+
+	// 2 is the only even prime, every odd start of 2 bits is 3
+	if (bits == 2)
+		return engine.uniform_range(2_infint, 3_infint);
+
+	InfInt limit = InfInt::pos_one << bits;
+	std::vector<bool> composite(prime_window);
+	while (true) {
+		InfInt start = engine.random_with_top_bits(bits, top) | InfInt::pos_one;
+
+		if (bits <= 17) {
+			InfInt p = next_prime(start - InfInt::pos_one);
+			if (p < limit)
+				return p;
+			continue;
+		}
+
+		InfInt p = prime_in_window(start, limit, composite);
+		if (p != InfInt::zero)
+			return p;
+	}
+}
+
+InfInt parallel_random_prime(InfInt::size_type bits, unsigned threads, InfIntRandomEngine::result_type seed, InfInt::size_type top) {
+	if (bits < 2)
+		throw std::domain_error("InfInt InfIntMath::parallel_random_prime(InfInt::size_type bits, unsigned threads, InfIntRandomEngine::result_type seed, InfInt::size_type top): must have bits >= 2");
+	if (top == 0 || top >= bits)
+		throw std::domain_error("InfInt InfIntMath::parallel_random_prime(InfInt::size_type bits, unsigned threads, InfIntRandomEngine::result_type seed, InfInt::size_type top): must have 0 < top < bits (bits=" + std::to_string(bits) + ", top=" + std::to_string(top) + ")");
+	std::seed_seq seq{seed};
+	InfIntRandomEngine engine(static_cast<InfIntRandomEngine::result_type>(bits), seq);
+	if (bits <= 17)
+		return random_prime(bits, engine, top);
+
+	// the candidates are handed out in order, so a worker can drop every one
+	// above the lowest prime found so far and none below it is ever skipped
+	InfInt limit = InfInt::pos_one << bits;
+	std::vector<bool> composite(prime_window);
+	std::vector<std::size_t> survivors;
+	while (true) {
+		InfInt start = engine.random_with_top_bits(bits, top) | InfInt::pos_one;
+		sieve_window(start, composite);
+		survivors.clear();
+		for (std::size_t j = 0; j < composite.size(); ++j)
+			if (!composite[j])
+				survivors.push_back(j);
+
+		std::atomic<std::size_t> best(survivors.size());
+		parallel_chunks(survivors.size(), 1, threads, [&](std::size_t begin, std::size_t end) {
+			for (std::size_t i = begin; i < end && i < best.load(); ++i) {
+				InfInt candidate = start + InfInt(2 * survivors[i]);
+				if (candidate >= limit)
+					return;
+				if (candidate.size() <= 32 || (probable_prime_base(candidate, 2_infint) && strong_lucas_probable_prime(candidate))) {
+					std::size_t current = best.load();
+					while (i < current && !best.compare_exchange_weak(current, i));
+				}
+			}
+		});
+		if (best.load() < survivors.size())
+			return start + InfInt(2 * survivors[best.load()]);
+	}
+}
+
+InfInt parallel_random_prime(InfInt::size_type bits, unsigned threads) {
+	InfIntRandomEngine engine(32);
+	return parallel_random_prime(bits, threads, engine().to_int<InfIntRandomEngine::result_type>());
+}
+
+std::vector<std::uint32_t> primes_up_to(std::uint32_t n) {
+	if (n < small_primes.back())
+		return std::vector<std::uint32_t>(small_primes.begin(), std::upper_bound(small_primes.begin(), small_primes.end(), n));
+
+	// composite[i] is about 2 * i + 1
+	std::vector<bool> composite(n / 2 + 1);
+	std::vector<std::uint32_t> primes{2};
+	for (std::uint64_t i = 1; 2 * i + 1 <= n; ++i) {
+		if (composite[i])
+			continue;
+		primes.push_back(static_cast<std::uint32_t>(2 * i + 1));
+		for (std::uint64_t j = 2 * i * (i + 1); j < composite.size(); j += 2 * i + 1)
+			composite[j] = true;
+	}
+	return primes;
+}
+
+InfInt product(std::span<const InfInt> values) {
+	if (values.empty())
+		return InfInt::pos_one;
+	if (values.size() == 1)
+		return values[0];
+	std::size_t half = values.size() / 2;
+	return product(values.first(half)) * product(values.subspan(half));
+}
+
+InfInt product(std::span<const std::uint32_t> factors) {
+	std::vector<InfInt> leaves;
+	std::uint64_t word = 1;
+	for (std::uint32_t f : factors) {
+		if (f == 0)
+			return InfInt::zero;
+		if (word > std::numeric_limits<std::uint64_t>::max() / f) {
+			leaves.emplace_back(word);
+			word = 1;
+		}
+		word *= f;
+	}
+	leaves.emplace_back(word);
+	return product(std::span<const InfInt>(leaves));
+}
+
+// Luschny: n! = (n/2)!^2 swing(n), where the prime p appears in swing(n)
+// with exponent sum_i (n / p^i) mod 2. The powers of two are left out of
+// every swing and restored at the end as a shift by n - popcount(n)
+InfInt factorial(std::uint32_t n) {
+	std::vector<std::uint32_t> primes = primes_up_to(n);
+	std::vector<std::uint32_t> swing;
+	InfInt odd = InfInt::pos_one;
+	for (int i = std::bit_width(n) - 1; i >= 0; --i) {
+		std::uint32_t m = n >> i;
+		swing.clear();
+		for (std::size_t j = 1; j < primes.size() && primes[j] <= m; ++j)
+			for (std::uint32_t q = m / primes[j]; q != 0; q /= primes[j])
+				if (q & 1)
+					swing.push_back(primes[j]);
+		odd = odd * odd * product(std::span<const std::uint32_t>(swing));
+	}
+	return odd << (n - std::popcount(n));
+}
+
+// Legendre: the exponent of p is sum_i n / p^i - k / p^i - (n - k) / p^i
+InfInt binomial(std::uint32_t n, std::uint32_t k) {
+	if (k > n)
+		return InfInt::zero;
+	std::vector<std::uint32_t> factors;
+	for (std::uint32_t p : primes_up_to(n)) {
+		std::uint64_t e = 0;
+		for (std::uint64_t q = p; q <= n; q *= p)
+			e += n / q - k / q - (n - k) / q;
+		factors.insert(factors.end(), e, p);
+	}
+	return product(std::span<const std::uint32_t>(factors));
+}
+
+InfInt primorial(std::uint32_t n) {
+	return product(std::span<const std::uint32_t>(primes_up_to(n)));
+}
+
+void parallel_chunks(std::size_t size, std::size_t chunk, unsigned threads, const std::function<void(std::size_t, std::size_t)>& f) {
+	std::size_t chunks = (size + chunk - 1) / chunk;
+	if (threads == 0)
+		threads = 1;
+	if (chunks < threads)
+		threads = static_cast<unsigned>(chunks);
+
+	// the first exception stops the pool and is rethrown once all are joined
+	std::atomic<std::size_t> next(0);
+	std::exception_ptr error;
+	std::mutex error_mutex;
+	auto worker = [&]() {
+		try {
+			for (std::size_t c = next++; c < chunks; c = next++)
+				f(c * chunk, std::min(size, (c + 1) * chunk));
+		} catch (...) {
+			next = chunks;
+			std::lock_guard<std::mutex> lock(error_mutex);
+			if (!error)
+				error = std::current_exception();
+		}
+	};
+	std::vector<std::thread> pool;
+	for (unsigned t = 1; t < threads; ++t)
+		pool.emplace_back(worker);
+	if (threads != 0)
+		worker();
+	for (std::thread& thread : pool)
+		thread.join();
+	if (error)
+		std::rethrow_exception(error);
+}
+
+ProductTree product_tree(std::span<const InfInt> values) {
+	ProductTree tree(1, std::vector<InfInt>(values.begin(), values.end()));
+	while (tree.back().size() > 1) {
+		const std::vector<InfInt>& below = tree.back();
+		std::vector<InfInt> level;
+		level.reserve((below.size() + 1) / 2);
+		for (std::size_t i = 0; i + 1 < below.size(); i += 2)
+			level.push_back(below[i] * below[i + 1]);
+		if (below.size() % 2 != 0)
+			level.push_back(below.back());
+		tree.push_back(std::move(level));
+	}
+	return tree;
+}
+
+void remainder_tree(const ProductTree& tree, const InfInt& x, std::span<InfInt> remainders, bool squared) {
+	auto reduce = [squared](const InfInt& r, const InfInt& m) { return squared ? r % (m * m) : r % m; };
+	const InfInt& root = tree.back()[0];
+	std::vector<InfInt> current{modulo(x, squared ? root * root : root)};
+	for (std::size_t level = tree.size() - 1; level-- > 0;) {
+		std::vector<InfInt> next(tree[level].size());
+		for (std::size_t i = 0; i < next.size(); ++i)
+			next[i] = reduce(current[i / 2], tree[level][i]);
+		current = std::move(next);
+	}
+	std::move(current.begin(), current.end(), remainders.begin());
+}
+
+std::vector<InfInt> chunk_products(std::span<const InfInt> values, unsigned threads) {
+	std::vector<InfInt> products((values.size() + tree_chunk - 1) / tree_chunk);
+	parallel_chunks(values.size(), tree_chunk, threads, [&](std::size_t begin, std::size_t end) {
+		products[begin / tree_chunk] = product(values.subspan(begin, end - begin));
+	});
+	return products;
+}
+
+// x is first reduced by the tree over the chunk products, then each chunk
+// rebuilds its own tree and descends from there
+std::vector<InfInt> remainder_tree(const InfInt& x, std::span<const InfInt> moduli, std::span<const InfInt> products, unsigned threads, bool squared) {
+	std::vector<InfInt> remainders(moduli.size());
+	if (moduli.empty())
+		return remainders;
+	std::vector<InfInt> chunk_remainders(products.size());
+	remainder_tree(product_tree(products), x, chunk_remainders, squared);
+	parallel_chunks(moduli.size(), tree_chunk, threads, [&](std::size_t begin, std::size_t end) {
+		ProductTree tree = product_tree(moduli.subspan(begin, end - begin));
+		remainder_tree(tree, chunk_remainders[begin / tree_chunk], std::span<InfInt>(remainders).subspan(begin, end - begin), squared);
+	});
+	return remainders;
+}
+
+std::vector<InfInt> remainder_tree(const InfInt& x, std::span<const InfInt> moduli, unsigned threads) {
+	return remainder_tree(x, moduli, chunk_products(moduli, threads), threads, false);
+}
+
+// with P the product of all the values, (P mod n^2) / n = (P / n) mod n
+std::vector<InfInt> batch_gcd(std::span<const InfInt> values, unsigned threads) {
+	std::vector<InfInt> products = chunk_products(values, threads);
+	std::vector<InfInt> gcds = remainder_tree(product(products), values, products, threads, true);
+	parallel_chunks(values.size(), tree_chunk, threads, [&](std::size_t begin, std::size_t end) {
+		for (std::size_t i = begin; i < end; ++i)
+			gcds[i] = gcd(values[i], gcds[i] / values[i]);
+	});
+	return gcds;
+}
+
+// Brent's cycle finding on x^2 + c, with the differences multiplied
+// together and a gcd only every 128 steps; when that gcd is n the last
+// batch is replayed one step at a time
+InfInt pollard_brent(const InfInt& n, const InfInt& c, std::size_t max_steps) {
+	const std::size_t batch = 128;
+	InfModInt::Context context = InfModInt::context(n);
+	InfModInt c_n(c, context);
+	InfModInt y(2_infint, context);
+	InfModInt x = y;
+	InfModInt ys = y;
+	InfModInt q(InfInt::pos_one, context);
+	InfInt g = InfInt::pos_one;
+	for (std::size_t r = 1; g == InfInt::pos_one; r *= 2) {
+		if (r > max_steps)
+			return InfInt::zero;
+		x = y;
+		for (std::size_t i = 0; i < r; ++i)
+			y = y * y + c_n;
+		for (std::size_t k = 0; k < r && g == InfInt::pos_one; k += batch) {
+			ys = y;
+			for (std::size_t i = 0; i < std::min(batch, r - k); ++i) {
+				y = y * y + c_n;
+				q *= x - y;
+			}
+			g = gcd(q.value(), n);
+		}
+	}
+	if (g == n)
+		do {
+			ys = ys * ys + c_n;
+			g = gcd((x - ys).value(), n);
+		} while (g == InfInt::pos_one);
+	return g == n ? InfInt::zero : g;
+}
+
+MontgomeryPoint ecm_double(const MontgomeryPoint& p, const InfModInt& a24) {
+	InfModInt sum = p[0] + p[1];
+	InfModInt difference = p[0] - p[1];
+	sum *= sum;
+	difference *= difference;
+	InfModInt t = sum - difference;
+	return {sum * difference, t * (difference + a24 * t)};
+}
+
+MontgomeryPoint ecm_add(const MontgomeryPoint& p, const MontgomeryPoint& q, const MontgomeryPoint& diff) {
+	InfModInt u = (p[0] - p[1]) * (q[0] + q[1]);
+	InfModInt v = (p[0] + p[1]) * (q[0] - q[1]);
+	InfModInt sum = u + v;
+	InfModInt difference = u - v;
+	return {diff[1] * sum * sum, diff[0] * difference * difference};
+}
+
+// Montgomery's ladder, keeping r1 - r0 = p
+MontgomeryPoint ecm_multiply(const MontgomeryPoint& p, std::uint64_t k, const InfModInt& a24) {
+	if (k == 0)
+		return {InfModInt(InfInt::pos_one, p[0].context()), InfModInt(p[0].context())};
+	MontgomeryPoint r0 = p;
+	MontgomeryPoint r1 = ecm_double(p, a24);
+	for (int i = std::bit_width(k) - 2; i >= 0; --i) {
+		if ((k >> i) & 1) {
+			r0 = ecm_add(r1, r0, p);
+			r1 = ecm_double(r1, a24);
+		} else {
+			r1 = ecm_add(r1, r0, p);
+			r0 = ecm_double(r0, a24);
+		}
+	}
+	return r0;
+}
+
+// stage 1 multiplies by every prime power up to B1; stage 2 looks for one
+// more prime p up to primes.back() as p = m D +- j, comparing the giant
+// steps [m D]Q with the baby steps [j]Q through X_mD Z_j - X_j Z_mD. The
+// giant steps are differential additions, so m starts at 2 at least: with
+// m = 1 the first difference [(m - 1) D]Q would be the point at infinity
+InfInt ecm_curve(const InfInt& n, const InfInt& sigma, std::uint32_t B1, const std::vector<std::uint32_t>& primes, const std::function<bool(void)>& stop) {
+	const std::uint32_t D = 210;
+	if (B1 < D + D / 2)
+		throw std::domain_error("InfInt InfIntMath::ecm_curve(const InfInt& n, const InfInt& sigma, std::uint32_t B1, const std::vector<std::uint32_t>& primes, const std::function<bool(void)>& stop): must have B1 >= 315");
+
+	// Suyama: u = sigma^2 - 5, v = 4 sigma, Q = (u^3 : v^3),
+	// a24 = (v - u)^3 (3 u + v) / (16 u^3 v)
+	InfModInt::Context context = InfModInt::context(n);
+	InfModInt s(sigma, context);
+	InfModInt u = s * s - InfModInt(5_infint, context);
+	InfModInt v = InfModInt(4_infint, context) * s;
+	InfModInt u3 = u * u * u;
+	InfModInt denominator = InfModInt(16_infint, context) * u3 * v;
+	InfInt g = gcd(denominator.value(), n);
+	if (g != InfInt::pos_one)
+		return g == n ? InfInt::zero : g;
+	InfModInt w = v - u;
+	InfModInt a24 = w * w * w * (InfModInt(3_infint, context) * u + v) / denominator;
+	MontgomeryPoint q = {u3, v * v * v};
+
+	std::size_t i = 0;
+	for (; i < primes.size() && primes[i] <= B1; ++i) {
+		if (stop && stop())
+			return InfInt::zero;
+		std::uint64_t power = primes[i];
+		while (power <= B1 / primes[i])
+			power *= primes[i];
+		q = ecm_multiply(q, power, a24);
+	}
+	g = gcd(q[1].value(), n);
+	if (g != InfInt::pos_one)
+		return g == n ? InfInt::zero : g;
+
+	std::vector<MontgomeryPoint> baby(D / 2, q);
+	MontgomeryPoint q2 = ecm_double(q, a24);
+	baby[3] = ecm_add(q2, q, q);
+	for (std::uint32_t j = 5; j < D / 2; j += 2)
+		baby[j] = ecm_add(baby[j - 2], q2, baby[j - 4]);
+
+	std::uint64_t m = (B1 + D / 2) / D;
+	MontgomeryPoint giant_step = ecm_multiply(q, D, a24);
+	MontgomeryPoint previous = ecm_multiply(q, (m - 1) * D, a24);
+	MontgomeryPoint giant = ecm_multiply(q, m * D, a24);
+	InfModInt accumulator(InfInt::pos_one, context);
+	for (; i < primes.size(); ++i) {
+		while (primes[i] > m * D + D / 2) {
+			if (stop && stop())
+				return InfInt::zero;
+			MontgomeryPoint next = ecm_add(giant, giant_step, previous);
+			previous = std::move(giant);
+			giant = std::move(next);
+			++m;
+		}
+		std::uint64_t j = primes[i] > m * D ? primes[i] - m * D : m * D - primes[i];
+		accumulator *= giant[0] * baby[j][1] - baby[j][0] * giant[1];
+	}
+	g = gcd(accumulator.value(), n);
+	return g == n || g == InfInt::pos_one ? InfInt::zero : g;
+}
+
+// curves are handed out to the workers one at a time and the first factor
+// stops the others
+InfInt ecm(const InfInt& n, std::uint32_t B1, unsigned curves, unsigned threads) {
+	std::vector<std::uint32_t> primes = primes_up_to(100 * B1);
+	std::atomic<bool> done(false);
+	InfInt found;
+	parallel_chunks(curves, 1, threads, [&](std::size_t curve, std::size_t) {
+		if (done.load())
+			return;
+		InfInt d = ecm_curve(n, InfInt(B1 + curve), B1, primes, [&]() { return done.load(); });
+		if (d != InfInt::zero && !done.exchange(true))
+			found = d;
+	});
+	return done.load() ? found : InfInt::zero;
+}
+
+InfInt find_factor(const InfInt& n, unsigned threads) {
+	// B1 and number of curves for factors of about 15, 20, 25, 30 and 35 digits
+	static const std::array<std::pair<std::uint32_t, unsigned>, 5> ecm_schedule = {{
+		{2'000, 25}, {11'000, 90}, {50'000, 300}, {250'000, 700}, {1'000'000, 1'800}
+	}};
+	for (long long c = 1; c <= 3; ++c) {
+		InfInt d = pollard_brent(n, InfInt(c));
+		if (d != InfInt::zero)
+			return d;
+	}
+	for (const std::pair<std::uint32_t, unsigned>& level : ecm_schedule) {
+		InfInt d = ecm(n, level.first, level.second, threads);
+		if (d != InfInt::zero)
+			return d;
+	}
+	throw std::domain_error("InfInt InfIntMath::find_factor(const InfInt& n, unsigned threads): no factor found (n=" + n.str() + ")");
+}
+
+std::map<InfInt, unsigned> factor(const InfInt& n, unsigned threads) {
+	if (n == InfInt::zero)
+		throw std::domain_error("std::map<InfInt, unsigned> InfIntMath::factor(const InfInt& n, unsigned threads): must have n != 0");
+
+	std::map<InfInt, unsigned> factors;
+	if (n.sign())
+		factors[InfInt::neg_one] = 1;
+	InfInt m = abs(n);
+	for (std::uint32_t p = trial_division(m); p != 0; p = trial_division(m)) {
+		InfInt big_p(p);
+		while (InfInt::divisible_by(m, big_p)) {
+			m = InfInt::divexact(m, big_p);
+			++factors[big_p];
+		}
+	}
+
+	// what is left has no factor below small_primes_limit
+	std::vector<std::pair<InfInt, unsigned>> pending;
+	if (m != InfInt::pos_one)
+		pending.emplace_back(m, 1);
+	while (!pending.empty()) {
+		auto [composite, multiplicity] = pending.back();
+		pending.pop_back();
+		if (probable_prime(composite)) {
+			factors[composite] += multiplicity;
+			continue;
+		}
+		if (is_perfect_power(composite)) {
+			for (unsigned long k = 2;; k = next_prime(InfInt(k)).to_int<unsigned long>()) {
+				InfInt r = nth_root(composite, k);
+				if (pow(r, InfInt(k)) == composite) {
+					pending.emplace_back(r, multiplicity * k);
+					break;
+				}
+			}
+			continue;
+		}
+		InfInt d = find_factor(composite, threads);
+		pending.emplace_back(InfInt::divexact(composite, d), multiplicity);
+		pending.emplace_back(d, multiplicity);
+	}
+	return factors;
 }
 
 } // namespace InfIntMath
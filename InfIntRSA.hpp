@@ -1,31 +1,80 @@
 #ifndef INFINTRSA_HPP
 #define INFINTRSA_HPP
 
+// std libs
+#include <iostream>
+#include <vector>
+#include <span>
+#include <thread>
+#include <algorithm>
+#include <numeric>
+#include <bit>
+#include <cstdint>
+#include <stdexcept>
+
 // InfInt libs
 #include "InfInt.hpp"
 #include "InfIntMath.hpp"
+#include "InfModInt.hpp"
+#include "InfIntRandom.hpp"
 
 class InfIntRSA {
 public:
+	enum Totient {
+		euler, // d = e^-1 mod phi(n)
+		carmichael // d = e^-1 mod lambda(n), same keys with a smaller d
+	};
+
 	InfIntRSA(void);
 	InfIntRSA(const InfInt& p, const InfInt& q);
 	InfIntRSA(const InfInt& p, const InfInt& q, const InfInt& min_e);
 	~InfIntRSA(void);
 	void create_keys(const InfInt& p, const InfInt& q);
 	void create_keys(const InfInt& p, const InfInt& q, const InfInt& min_e);
-	InfInt cypher(const InfInt& cyphered);
-	InfInt uncypher(const InfInt& uncyphered);
-	InfInt& e(void) { return this->m_e; }
-	InfInt& d(void) { return this->m_d; }
-	InfInt& n(void) { return this->m_n; }
+	void create_keys(const std::vector<InfInt>& primes, Totient totient = euler); // multi-prime, n is their product
+	void create_keys(const std::vector<InfInt>& primes, const InfInt& min_e, Totient totient = euler); // smallest e >= min_e prime to the totient
+	void generate_keys(InfInt::size_type bits, unsigned primes = 2, Totient totient = euler, unsigned threads = std::thread::hardware_concurrency());
+	void public_key(const InfInt& e, const InfInt& n); // encryption only, drops any private key
+	void private_key(const InfInt& e, const InfInt& d, const InfInt& n); // without the primes, no CRT
+	bool has_private_key(void) const;
+	InfInt cypher(const InfInt& cyphered) const;
+	InfInt uncypher(const InfInt& uncyphered, unsigned threads = 1) const; // threads share the primes, decrypt_batch is the parallel path
+	void encrypt_batch(std::span<const InfInt> messages, std::span<InfInt> cyphered, unsigned threads = std::thread::hardware_concurrency()) const;
+	void decrypt_batch(std::span<const InfInt> cyphered, std::span<InfInt> messages, unsigned threads = std::thread::hardware_concurrency()) const;
+	void encrypt_stream(std::istream& in, std::ostream& out, unsigned threads = std::thread::hardware_concurrency()) const; // until the end of in
+	void decrypt_stream(std::istream& in, std::ostream& out, unsigned threads = std::thread::hardware_concurrency()) const;
+	const InfInt& e(void) const { return this->m_e; }
+	const InfInt& d(void) const { return this->m_d; }
+	const InfInt& n(void) const { return this->m_n; }
+	const std::vector<InfInt>& primes(void) const { return this->m_primes; }
+	const std::vector<InfInt>& exponents(void) const { return this->m_exponents; }
+	const std::vector<InfInt>& coefficients(void) const { return this->m_coefficients; }
+
+	// streams are cut into blocks of plain_block() bytes, each stored as
+	// 0x01 || bytes so that the length survives, and written as big endian
+	// cypher_block() bytes; stream_blocks blocks are in memory at a time
+	static const std::size_t stream_blocks;
+	std::size_t plain_block(void) const;
+	std::size_t cypher_block(void) const;
 protected:
+	static InfInt totient_of(const std::vector<InfInt>& primes, Totient totient);
+	void precompute(const std::vector<InfInt>& primes);
+
 	InfInt m_e;
 	InfInt m_d;
 	InfInt m_n;
+	// CRT form of the private key, empty in public only mode
+	std::vector<InfInt> m_primes; // r_0 = p, r_1 = q, r_2 ...
+	std::vector<InfInt> m_exponents; // d mod (r_i - 1)
+	std::vector<InfInt> m_coefficients; // RFC 8017: qInv = q^-1 mod p, then t_i = (r_0 ... r_i-1)^-1 mod r_i for i >= 2
+	std::vector<InfModInt::Context> m_contexts; // one per prime
+	InfModInt::Context m_context_n; // shared by every thread, never changed after the keys are set
 };
 
 
 
+const std::size_t InfIntRSA::stream_blocks = 256;
+
 InfIntRSA::InfIntRSA(void) {
 	//
 }
@@ -45,11 +94,21 @@ InfIntRSA::~InfIntRSA(void) {
 }
 
 void InfIntRSA::create_keys(const InfInt& p, const InfInt& q) {
-	this->m_n = p * q;
+	this->create_keys(std::vector<InfInt>{ p, q });
+}
+
+void InfIntRSA::create_keys(const InfInt& p, const InfInt& q, const InfInt& min_e) {
+	this->create_keys(std::vector<InfInt>{ p, q }, min_e);
+}
+
+void InfIntRSA::create_keys(const std::vector<InfInt>& primes, Totient totient) {
+	if (primes.size() < 2)
+		throw std::invalid_argument("void InfIntRSA::create_keys(const std::vector<InfInt>& primes, Totient totient): needs at least two primes");
+	this->m_n = InfIntMath::product(primes);
 
 	//std::cout << "n: " << this->m_n << std::endl;
 
-	InfInt phi((p - InfInt::pos_one) * (q - InfInt::pos_one));
+	InfInt phi = totient_of(primes, totient);
 
 	//std::cout << "phi: " << phi << std::endl;
 
@@ -58,42 +117,248 @@ void InfIntRSA::create_keys(const InfInt& p, const InfInt& q) {
 	//std::cout << "e: " << this->m_e << std::endl;
 
 	this->m_d = InfIntMath::modinv(this->m_e, phi);
-	if (this->m_d.sign())
-		this->m_d += phi;
 
 	//std::cout << "d: " << this->m_d << std::endl;
+
+	this->precompute(primes);
 }
 
-void InfIntRSA::create_keys(const InfInt& p, const InfInt& q, const InfInt& min_e) {
-	this->m_n = p * q;
+// lambda(n) has the same prime factors as phi(n), so both give the same e.
+// While the candidates fit in a word, gcd(e, phi) = gcd(e, phi mod e) is
+// taken on the words of phi, which are split once; an even phi also rules
+// out every even candidate
+void InfIntRSA::create_keys(const std::vector<InfInt>& primes, const InfInt& min_e, Totient totient) {
+	if (primes.size() < 2)
+		throw std::invalid_argument("void InfIntRSA::create_keys(const std::vector<InfInt>& primes, const InfInt& min_e, Totient totient): needs at least two primes");
+	this->m_n = InfIntMath::product(primes);
 
 	//std::cout << "n: " << this->m_n << std::endl;
 
-	InfInt phi((p - InfInt::pos_one) * (q - InfInt::pos_one));
+	InfInt phi = totient_of(primes, totient);
 
 	//std::cout << "phi: " << phi << std::endl;
 
-	for (
-		this->m_e = min_e;
-		!InfIntMath::coprime(this->m_e, phi);
-		++this->m_e
-		);
+	this->m_e = min_e;
+	std::uint64_t step = 1;
+	if (!phi.get(0)) {
+		step = 2;
+		if (!this->m_e.get(0))
+			++this->m_e;
+	}
+	if (this->m_e > InfInt::zero && this->m_e <= InfInt(UINT32_MAX)) {
+		std::vector<std::uint32_t> words = phi.to_words<std::uint32_t>();
+		std::uint64_t e = this->m_e.to_int<std::uint64_t>();
+		while (e <= UINT32_MAX && std::gcd(e, static_cast<std::uint64_t>(InfIntMath::mod_small(words, static_cast<std::uint32_t>(e)))) != 1)
+			e += step;
+		this->m_e = InfInt(e);
+	}
+	while (!InfIntMath::coprime(this->m_e, phi))
+		this->m_e += InfInt(step);
 
 	//std::cout << "e: " << this->m_e << std::endl;
 
-	this->m_d = InfIntMath::egcd(this->m_e, phi).x();
-	if (this->m_d.sign())
-		this->m_d += phi;
+	this->m_d = InfIntMath::modinv(this->m_e, phi);
 
 	//std::cout << "d: " << this->m_d << std::endl;
+
+	this->precompute(primes);
+}
+
+// bits / primes bits per prime, each one distinct and with r - 1 prime to 65537.
+// A prime of s bits with its top bits set is at least (1 - 2^-top) 2^s,
+// and for at most 2^(top - 1) primes the product of the (1 - 2^-top) stays
+// above 1/2, so n always has exactly bits bits
+void InfIntRSA::generate_keys(InfInt::size_type bits, unsigned primes, Totient totient, unsigned threads) {
+	if (primes < 2 || bits / primes < 16)
+		throw std::invalid_argument("void InfIntRSA::generate_keys(InfInt::size_type bits, unsigned primes, Totient totient, unsigned threads): must have primes >= 2 and bits >= 16 primes");
+	const InfInt e(65'537);
+	const InfInt::size_type top = std::bit_width(primes - 1) + 1;
+	InfIntRandomEngine seeds(32);
+	std::vector<InfInt> chosen;
+	while (chosen.size() < primes) {
+		InfInt::size_type size = bits / primes + (chosen.size() < bits % primes ? 1 : 0);
+		InfInt r = InfIntMath::parallel_random_prime(size, threads, seeds().to_int<InfIntRandomEngine::result_type>(), top);
+		if ((r - InfInt::pos_one) % e != InfInt::zero && std::find(chosen.begin(), chosen.end(), r) == chosen.end())
+			chosen.push_back(r);
+	}
+	this->create_keys(chosen, totient);
+}
+
+void InfIntRSA::public_key(const InfInt& e, const InfInt& n) {
+	this->m_e = e;
+	this->m_n = n;
+	this->m_d = InfInt::zero;
+	this->m_primes.clear();
+	this->m_exponents.clear();
+	this->m_coefficients.clear();
+	this->m_contexts.clear();
+	this->m_context_n = InfModInt::context(n);
+}
+
+void InfIntRSA::private_key(const InfInt& e, const InfInt& d, const InfInt& n) {
+	this->public_key(e, n);
+	this->m_d = d;
+}
+
+bool InfIntRSA::has_private_key(void) const {
+	return this->m_d != InfInt::zero;
+}
+
+InfInt InfIntRSA::totient_of(const std::vector<InfInt>& primes, Totient totient) {
+	InfInt phi = InfInt::pos_one;
+	for (const InfInt& r : primes)
+		phi = totient == carmichael ? InfIntMath::lcm(phi, r - InfInt::pos_one) : phi * (r - InfInt::pos_one);
+	return phi;
+}
+
+void InfIntRSA::precompute(const std::vector<InfInt>& primes) {
+	this->m_primes = primes;
+	this->m_exponents.clear();
+	this->m_coefficients.clear();
+	this->m_contexts.clear();
+	for (const InfInt& r : primes) {
+		this->m_exponents.push_back(this->m_d % (r - InfInt::pos_one));
+		this->m_contexts.push_back(InfModInt::context(r));
+	}
+	this->m_coefficients.push_back(InfIntMath::modinv(primes[1] % primes[0], primes[0]));
+	InfInt prefix = primes[0] * primes[1];
+	for (std::size_t i = 2; i < primes.size(); ++i) {
+		this->m_coefficients.push_back(InfIntMath::modinv(prefix % primes[i], primes[i]));
+		prefix *= primes[i];
+	}
+	this->m_context_n = InfModInt::context(this->m_n);
+}
+
+InfInt InfIntRSA::cypher(const InfInt& unciphered) const {
+	if (this->m_context_n == nullptr)
+		throw std::domain_error("InfInt InfIntRSA::cypher(const InfInt& unciphered) const: no public key");
+	return InfModInt(unciphered, this->m_context_n).pow(this->m_e).value();
+}
+
+// one exponentiation per prime, recombined as in RFC 8017 5.1.2 step 2.b, then
+// checked against the public key so that a faulty residue cannot leak a
+// factor of n; a key set without its primes takes one exponentiation mod n
+InfInt InfIntRSA::uncypher(const InfInt& ciphered, unsigned threads) const {
+	if (!this->has_private_key())
+		throw std::domain_error("InfInt InfIntRSA::uncypher(const InfInt& ciphered, unsigned threads) const: no private key");
+	if (this->m_primes.empty())
+		return InfModInt(ciphered, this->m_context_n).pow_window(this->m_d).value();
+
+	std::vector<InfInt> residues(this->m_primes.size());
+	InfIntMath::parallel_chunks(residues.size(), 1, threads, [&](std::size_t begin, std::size_t end) {
+		for (std::size_t i = begin; i < end; ++i)
+			residues[i] = InfModInt(ciphered, this->m_contexts[i]).pow_window(this->m_exponents[i]).value();
+	});
+
+	// h = (m_1 - m_2) qInv mod p, m = m_2 + q h, then for each further prime
+	// h = (m_i - m) t_i mod r_i, m = m + R h with R the product of the primes before r_i
+	const InfModInt::Context& p = this->m_contexts[0];
+	InfModInt h = (InfModInt(residues[0], p) - InfModInt(residues[1], p)) * InfModInt(this->m_coefficients[0], p);
+	InfInt uncyphered = residues[1] + this->m_primes[1] * h.value();
+	InfInt prefix = this->m_primes[0] * this->m_primes[1];
+	for (std::size_t i = 2; i < residues.size(); ++i) {
+		const InfModInt::Context& r = this->m_contexts[i];
+		h = (InfModInt(residues[i], r) - InfModInt(uncyphered, r)) * InfModInt(this->m_coefficients[i - 1], r);
+		uncyphered += prefix * h.value();
+		prefix *= this->m_primes[i];
+	}
+	if (InfModInt(uncyphered, this->m_context_n).pow(this->m_e) != InfModInt(ciphered, this->m_context_n))
+		throw std::domain_error("InfInt InfIntRSA::uncypher(const InfInt& ciphered, unsigned threads) const: CRT fault check failed");
+	return uncyphered;
 }
 
-InfInt InfIntRSA::cypher(const InfInt& unciphered) {
-	return InfIntMath::modpow(unciphered, this->m_e, this->m_n);
+void InfIntRSA::encrypt_batch(std::span<const InfInt> messages, std::span<InfInt> cyphered, unsigned threads) const {
+	if (messages.size() != cyphered.size())
+		throw std::invalid_argument("void InfIntRSA::encrypt_batch(std::span<const InfInt> messages, std::span<InfInt> cyphered, unsigned threads) const: spans of different sizes");
+	InfIntMath::parallel_chunks(messages.size(), 1, threads, [&](std::size_t begin, std::size_t end) {
+		for (std::size_t i = begin; i < end; ++i)
+			cyphered[i] = this->cypher(messages[i]);
+	});
 }
 
-InfInt InfIntRSA::uncypher(const InfInt& ciphered) {
-	return InfIntMath::modpow(ciphered, this->m_d, this->m_n);
+// the threads take the messages one at a time from a shared index; a message
+// is decrypted on a single thread, all of its primes included
+void InfIntRSA::decrypt_batch(std::span<const InfInt> cyphered, std::span<InfInt> messages, unsigned threads) const {
+	if (cyphered.size() != messages.size())
+		throw std::invalid_argument("void InfIntRSA::decrypt_batch(std::span<const InfInt> cyphered, std::span<InfInt> messages, unsigned threads) const: spans of different sizes");
+	InfIntMath::parallel_chunks(cyphered.size(), 1, threads, [&](std::size_t begin, std::size_t end) {
+		for (std::size_t i = begin; i < end; ++i)
+			messages[i] = this->uncypher(cyphered[i], 1);
+	});
+}
+
+std::size_t InfIntRSA::plain_block(void) const {
+	return (this->m_n.size() - 1) / 8 - 1; // the marker takes one byte
+}
+
+std::size_t InfIntRSA::cypher_block(void) const {
+	return (this->m_n.size() + 7) / 8;
+}
+
+// each round reads stream_blocks blocks, encrypts them over the threads and
+// writes them back in order before reading the next ones
+void InfIntRSA::encrypt_stream(std::istream& in, std::ostream& out, unsigned threads) const {
+	if (this->m_n.size() < 17)
+		throw std::invalid_argument("void InfIntRSA::encrypt_stream(std::istream& in, std::ostream& out, unsigned threads) const: n is too small to hold a block (n=" + this->m_n.str() + ")");
+	std::size_t plain = this->plain_block();
+	std::size_t width = this->cypher_block();
+	std::vector<char> buffer(plain * stream_blocks);
+	std::vector<InfInt> messages(stream_blocks);
+	std::vector<InfInt> cyphered(stream_blocks);
+
+	while (in) {
+		in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+		std::size_t read = static_cast<std::size_t>(in.gcount());
+		std::size_t blocks = (read + plain - 1) / plain;
+		for (std::size_t i = 0; i < blocks; ++i) {
+			std::size_t begin = i * plain;
+			std::size_t end = std::min(read, begin + plain);
+			std::vector<std::uint8_t> bytes(end - begin + 1);
+			for (std::size_t j = begin; j < end; ++j)
+				bytes[end - 1 - j] = static_cast<std::uint8_t>(buffer[j]);
+			bytes.back() = 1;
+			messages[i] = InfInt::from_words(bytes);
+		}
+		this->encrypt_batch(std::span<const InfInt>(messages).first(blocks), std::span<InfInt>(cyphered).first(blocks), threads);
+		for (std::size_t i = 0; i < blocks; ++i) {
+			std::vector<std::uint8_t> bytes = cyphered[i].to_words<std::uint8_t>();
+			bytes.resize(width, 0);
+			for (std::size_t j = width; j-- > 0;)
+				out.put(static_cast<char>(bytes[j]));
+		}
+	}
+}
+
+void InfIntRSA::decrypt_stream(std::istream& in, std::ostream& out, unsigned threads) const {
+	if (this->m_n.size() < 17)
+		throw std::invalid_argument("void InfIntRSA::decrypt_stream(std::istream& in, std::ostream& out, unsigned threads) const: n is too small to hold a block (n=" + this->m_n.str() + ")");
+	std::size_t plain = this->plain_block();
+	std::size_t width = this->cypher_block();
+	std::vector<char> buffer(width * stream_blocks);
+	std::vector<InfInt> cyphered(stream_blocks);
+	std::vector<InfInt> messages(stream_blocks);
+
+	while (in) {
+		in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+		std::size_t read = static_cast<std::size_t>(in.gcount());
+		if (read % width != 0)
+			throw std::invalid_argument("void InfIntRSA::decrypt_stream(std::istream& in, std::ostream& out, unsigned threads) const: truncated block");
+		std::size_t blocks = read / width;
+		for (std::size_t i = 0; i < blocks; ++i) {
+			std::vector<std::uint8_t> bytes(width);
+			for (std::size_t j = 0; j < width; ++j)
+				bytes[width - 1 - j] = static_cast<std::uint8_t>(buffer[i * width + j]);
+			cyphered[i] = InfInt::from_words(bytes);
+		}
+		this->decrypt_batch(std::span<const InfInt>(cyphered).first(blocks), std::span<InfInt>(messages).first(blocks), threads);
+		for (std::size_t i = 0; i < blocks; ++i) {
+			std::vector<std::uint8_t> bytes = messages[i].to_words<std::uint8_t>();
+			if (bytes.empty() || bytes.back() != 1 || bytes.size() > plain + 1)
+				throw std::domain_error("void InfIntRSA::decrypt_stream(std::istream& in, std::ostream& out, unsigned threads) const: block without its marker");
+			for (std::size_t j = bytes.size() - 1; j-- > 0;)
+				out.put(static_cast<char>(bytes[j]));
+		}
+	}
 }
 
 #endif // INFINTRSA_HPP
\ No newline at end of file
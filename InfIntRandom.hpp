@@ -5,6 +5,10 @@
 #include <random>
 #include <chrono>
 #include <cmath>
+#include <cstdint>
+#include <vector>
+#include <stdexcept>
+#include <string>
 
 // InfInt libs
 #include "InfInt.hpp"
@@ -32,13 +36,25 @@ public:
 	void seed (Sseq& q);
 
 	InfInt operator()(void);
+	void operator()(InfInt& value); // same draw, written into value
 	void discard(unsigned long long z);
+
+	// rejection sampling, fewer than two draws expected
+	InfInt uniform_below(const InfInt& bound); // in [0, bound)
+	InfInt uniform_range(const InfInt& lo, const InfInt& hi); // in [lo, hi]
+	// exactly bits bits, whatever the size of the engine
+	InfInt random_odd(InfInt::size_type bits); // top and bottom bits set
+	InfInt random_with_top_bits(InfInt::size_type bits, InfInt::size_type top = 2); // with top = 2 the product of two such values has exactly 2 * bits bits
 protected:
+	void fill(InfInt::size_type begin, InfInt::size_type end); // random bits [begin, end) of m_words, m_words zeroed above
+	void place(result_type bits, InfInt::size_type offset);
+
 	RandomEngine m_random_engine;
 	result_type m_size;
 	result_type m_length;
 	result_type m_top_size;
 	result_type m_top_mask;
+	std::vector<std::uint32_t> m_words; // kept between draws
 };
 
 
@@ -108,15 +124,87 @@ void InfIntRandomEngine::seed(Sseq& q) {
 
 InfInt InfIntRandomEngine::operator()(void) {
 	InfInt tmp;
-	if (this->m_top_size != 0)
-		tmp |= this->m_top_mask & this->m_random_engine();
-	for (result_type i = 0; i < this->m_length; ++i) {
-		tmp <<= this->result_size;
-		tmp |= this->m_random_engine();
-	}
+	(*this)(tmp);
 	return tmp;
 }
 
+void InfIntRandomEngine::operator()(InfInt& value) {
+	this->m_words.assign(this->m_size / 32 + 2, 0);
+	this->fill(0, this->m_size);
+	value.assign_words(this->m_words);
+}
+
+// the top word is drawn alone first: above the top word of bound the draw is
+// thrown away at once, below it the rest can be anything
+InfInt InfIntRandomEngine::uniform_below(const InfInt& bound) {
+	if (bound <= InfInt::zero)
+		throw std::invalid_argument("InfInt InfIntRandomEngine::uniform_below(const InfInt& bound): must have bound > 0 (bound=" + bound.str() + ")");
+	std::vector<std::uint32_t> limit = bound.to_words<std::uint32_t>();
+	std::size_t n = limit.size();
+	InfInt::size_type low = 32 * (n - 1);
+	while (true) {
+		this->m_words.assign(n + 1, 0);
+		this->fill(low, bound.size());
+		if (this->m_words[n - 1] > limit[n - 1])
+			continue;
+		this->fill(0, low);
+		std::size_t i = n - 1;
+		while (i > 0 && this->m_words[i] == limit[i])
+			--i;
+		if (this->m_words[i] < limit[i])
+			break;
+	}
+	InfInt value;
+	value.assign_words(this->m_words);
+	return value;
+}
+
+InfInt InfIntRandomEngine::uniform_range(const InfInt& lo, const InfInt& hi) {
+	if (hi < lo)
+		throw std::invalid_argument("InfInt InfIntRandomEngine::uniform_range(const InfInt& lo, const InfInt& hi): must have lo <= hi (lo=" + lo.str() + ", hi=" + hi.str() + ")");
+	return lo + this->uniform_below(hi - lo + InfInt::pos_one);
+}
+
+InfInt InfIntRandomEngine::random_odd(InfInt::size_type bits) {
+	if (bits == 0)
+		throw std::invalid_argument("InfInt InfIntRandomEngine::random_odd(InfInt::size_type bits): must have bits > 0");
+	this->m_words.assign(bits / 32 + 2, 0);
+	this->fill(0, bits);
+	this->m_words[(bits - 1) / 32] |= static_cast<std::uint32_t>(1) << ((bits - 1) % 32);
+	this->m_words[0] |= 1;
+	InfInt value;
+	value.assign_words(this->m_words);
+	return value;
+}
+
+InfInt InfIntRandomEngine::random_with_top_bits(InfInt::size_type bits, InfInt::size_type top) {
+	if (top == 0 || bits < top)
+		throw std::invalid_argument("InfInt InfIntRandomEngine::random_with_top_bits(InfInt::size_type bits, InfInt::size_type top): must have 0 < top <= bits (bits=" + std::to_string(bits) + ", top=" + std::to_string(top) + ")");
+	this->m_words.assign(bits / 32 + 2, 0);
+	this->fill(0, bits);
+	for (InfInt::size_type i = bits - top; i < bits; ++i)
+		this->m_words[i / 32] |= static_cast<std::uint32_t>(1) << (i % 32);
+	InfInt value;
+	value.assign_words(this->m_words);
+	return value;
+}
+
+// the draws land at their offsets, the top one first
+void InfIntRandomEngine::fill(InfInt::size_type begin, InfInt::size_type end) {
+	InfInt::size_type length = (end - begin) / this->result_size;
+	InfInt::size_type top_size = (end - begin) % this->result_size;
+	if (top_size != 0)
+		this->place(((static_cast<result_type>(1) << top_size) - 1) & this->m_random_engine(), begin + length * this->result_size);
+	for (InfInt::size_type i = length; i-- > 0;)
+		this->place(this->result_mask & this->m_random_engine(), begin + i * this->result_size);
+}
+
+void InfIntRandomEngine::place(result_type bits, InfInt::size_type offset) {
+	std::uint64_t shifted = static_cast<std::uint64_t>(bits) << (offset % 32);
+	this->m_words[offset / 32] |= static_cast<std::uint32_t>(shifted);
+	this->m_words[offset / 32 + 1] |= static_cast<std::uint32_t>(shifted >> 32);
+}
+
 void InfIntRandomEngine::discard(unsigned long long z) {
 	this->m_random_engine.discard(this->m_length);
 	if (this->m_top_size != 0)
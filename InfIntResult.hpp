@@ -1,6 +1,10 @@
 #ifndef INFINTRESULT_HPP
 #define INFINTRESULT_HPP
 
+// std libs
+#include <vector>
+#include <cstddef>
+
 class InfInt;
 
 class InfIntResult {};
@@ -20,6 +24,19 @@ protected:
 
 
 
+class InfIntSqrtremResult: InfIntResult {
+public:
+	InfIntSqrtremResult(const InfInt& root, const InfInt& remainder);
+	~InfIntSqrtremResult(void);
+	const InfInt& root(void) const;
+	const InfInt& remainder(void) const;
+protected:
+	InfInt* m_root;
+	InfInt* m_remainder;
+};
+
+
+
 class InfIntEGCDResult: InfIntResult {
 public:
 	InfIntEGCDResult(const InfInt& gcd, const InfInt& x, const InfInt& y);
@@ -35,6 +52,40 @@ protected:
 
 
 
+class InfIntHGCDResult: InfIntResult {
+public:
+	InfIntHGCDResult(const InfInt& a, const InfInt& b, const InfInt& m00, const InfInt& m01, const InfInt& m10, const InfInt& m11);
+	~InfIntHGCDResult(void);
+	const InfInt& a(void) const;
+	const InfInt& b(void) const;
+	const InfInt& m00(void) const;
+	const InfInt& m01(void) const;
+	const InfInt& m10(void) const;
+	const InfInt& m11(void) const;
+protected:
+	InfInt* m_a;
+	InfInt* m_b;
+	InfInt* m_m00;
+	InfInt* m_m01;
+	InfInt* m_m10;
+	InfInt* m_m11;
+};
+
+
+
+class InfIntBatchModinvResult: InfIntResult {
+public:
+	InfIntBatchModinvResult(const std::vector<InfInt>& inverses, const std::vector<std::size_t>& failed);
+	~InfIntBatchModinvResult(void);
+	const std::vector<InfInt>& inverses(void) const; // 0 where there is no inverse
+	const std::vector<std::size_t>& failed(void) const; // sorted indices of the values without inverse
+protected:
+	std::vector<InfInt>* m_inverses;
+	std::vector<std::size_t>* m_failed;
+};
+
+
+
 // InfInt libs
 #include "InfInt.hpp"
 
@@ -55,6 +106,23 @@ const InfInt& InfIntFullDivResult::remainder(void) const { return *m_remainder;
 
 
 
+InfIntSqrtremResult::InfIntSqrtremResult(const InfInt& root, const InfInt& remainder):
+	m_root(new InfInt(root)),
+	m_remainder(new InfInt(remainder))
+{
+	//
+}
+
+InfIntSqrtremResult::~InfIntSqrtremResult(void) {
+	delete m_root;
+	delete m_remainder;
+}
+
+const InfInt& InfIntSqrtremResult::root(void) const { return *m_root; }
+const InfInt& InfIntSqrtremResult::remainder(void) const { return *m_remainder; }
+
+
+
 InfIntEGCDResult::InfIntEGCDResult(const InfInt& gcd, const InfInt& x, const InfInt& y) :
 	m_gcd(new InfInt(gcd)),
 	m_x(new InfInt(x)),
@@ -73,4 +141,50 @@ const InfInt& InfIntEGCDResult::gcd(void) const { return *m_gcd; }
 const InfInt& InfIntEGCDResult::x(void) const { return *m_x; }
 const InfInt& InfIntEGCDResult::y(void) const { return *m_y; }
 
+
+
+InfIntHGCDResult::InfIntHGCDResult(const InfInt& a, const InfInt& b, const InfInt& m00, const InfInt& m01, const InfInt& m10, const InfInt& m11) :
+	m_a(new InfInt(a)),
+	m_b(new InfInt(b)),
+	m_m00(new InfInt(m00)),
+	m_m01(new InfInt(m01)),
+	m_m10(new InfInt(m10)),
+	m_m11(new InfInt(m11))
+{
+	//
+}
+
+InfIntHGCDResult::~InfIntHGCDResult(void) {
+	delete m_a;
+	delete m_b;
+	delete m_m00;
+	delete m_m01;
+	delete m_m10;
+	delete m_m11;
+}
+
+const InfInt& InfIntHGCDResult::a(void) const { return *m_a; }
+const InfInt& InfIntHGCDResult::b(void) const { return *m_b; }
+const InfInt& InfIntHGCDResult::m00(void) const { return *m_m00; }
+const InfInt& InfIntHGCDResult::m01(void) const { return *m_m01; }
+const InfInt& InfIntHGCDResult::m10(void) const { return *m_m10; }
+const InfInt& InfIntHGCDResult::m11(void) const { return *m_m11; }
+
+
+
+InfIntBatchModinvResult::InfIntBatchModinvResult(const std::vector<InfInt>& inverses, const std::vector<std::size_t>& failed) :
+	m_inverses(new std::vector<InfInt>(inverses)),
+	m_failed(new std::vector<std::size_t>(failed))
+{
+	//
+}
+
+InfIntBatchModinvResult::~InfIntBatchModinvResult(void) {
+	delete m_inverses;
+	delete m_failed;
+}
+
+const std::vector<InfInt>& InfIntBatchModinvResult::inverses(void) const { return *m_inverses; }
+const std::vector<std::size_t>& InfIntBatchModinvResult::failed(void) const { return *m_failed; }
+
 #endif // INFINTRESULT_HPP
\ No newline at end of file
@@ -0,0 +1,519 @@
+#ifndef INFMODINT_HPP
+#define INFMODINT_HPP
+
+// std libs
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+// InfInt libs
+#include "InfInt.hpp"
+
+// Everything that only depends on the modulus. Residues are kept as 32 bits
+// words, as many as the modulus has, and reduced with machine arithmetic:
+// Montgomery's REDC for odd moduli (the residues are then stored times
+// R = 2^(32 n)) and Barrett's reduction for even ones
+class InfModIntContext {
+public:
+	typedef std::uint32_t word_type;
+	typedef std::vector<word_type> words_type;
+
+	InfModIntContext(const InfInt& modulus);
+	~InfModIntContext(void);
+
+	const InfInt& modulus(void) const;
+	bool montgomery(void) const;
+
+	words_type to_form(const InfInt& a) const;
+	InfInt from_form(const words_type& a) const;
+	const words_type& zero(void) const;
+	const words_type& one(void) const;
+
+	words_type add(const words_type& a, const words_type& b) const;
+	words_type subtract(const words_type& a, const words_type& b) const;
+	words_type multiply(const words_type& a, const words_type& b) const;
+protected:
+	words_type redc(const words_type& a, const words_type& b) const;
+	words_type barrett(const words_type& a, const words_type& b) const;
+
+	static words_type product(const words_type& a, const words_type& b);
+	static bool add_in_place(words_type& a, const words_type& b); // carry out
+	static bool subtract_in_place(words_type& a, const words_type& b); // borrow out
+	static void reduce_once(words_type& a, const words_type& b, word_type carry); // a - b if carry or a >= b, without branching
+
+	InfInt m_modulus;
+	words_type m_words;
+	words_type m_zero;
+	words_type m_one;
+	word_type m_inverse; // montgomery: -modulus^-1 mod 2^32
+	words_type m_r2; // montgomery: R^2 mod modulus
+	words_type m_mu; // barrett: 2^(64 n) / modulus
+};
+
+
+
+// residue modulo the modulus of a shared context, always reduced
+class InfModInt {
+public:
+	typedef std::shared_ptr<const InfModIntContext> Context;
+
+	InfModInt(const Context& context); // 0
+	InfModInt(const InfInt& value, const Context& context);
+	InfModInt(const InfInt& value, const InfInt& modulus); // with a context of its own
+	InfModInt(const InfModInt& other) = default;
+	InfModInt(InfModInt&& other) = default;
+	~InfModInt(void) = default;
+
+	static Context context(const InfInt& modulus);
+
+	const Context& context(void) const;
+	const InfInt& modulus(void) const;
+	InfInt value(void) const; // in [0, modulus)
+	std::string str(void) const;
+
+	InfModInt inverse(void) const;
+	InfModInt pow(const InfInt& e) const;
+	InfModInt pow_ladder(const InfInt& e) const; // same operations whatever the bits of e
+	InfModInt pow_window(const InfInt& e) const; // same, with fewer products than the ladder
+
+	InfModInt& operator=(const InfModInt& other) = default;
+	InfModInt& operator=(InfModInt&& other) = default;
+	bool operator==(const InfModInt& other) const;
+	bool operator!=(const InfModInt& other) const;
+	InfModInt operator-(void) const;
+	InfModInt operator+(const InfModInt& other) const;
+	InfModInt& operator+=(const InfModInt& other);
+	InfModInt operator-(const InfModInt& other) const;
+	InfModInt& operator-=(const InfModInt& other);
+	InfModInt operator*(const InfModInt& other) const;
+	InfModInt& operator*=(const InfModInt& other);
+	InfModInt operator/(const InfModInt& other) const;
+	InfModInt& operator/=(const InfModInt& other);
+protected:
+	InfModInt(const InfModIntContext::words_type& form, const Context& context);
+	void check(const InfModInt& other) const;
+	static InfModIntContext::words_type exponent_bits(const InfInt& e, InfInt::size_type bits); // bits [0, bits) of e >= 0, read without branching on e.size()
+
+	Context m_context;
+	InfModIntContext::words_type m_form;
+};
+
+std::ostream& operator<<(std::ostream& out, const InfModInt& infmodint);
+
+
+
+// the definitions need InfIntMath, which itself uses InfModInt
+#include "InfIntMath.hpp"
+
+InfModIntContext::InfModIntContext(const InfInt& modulus):
+	m_modulus(modulus),
+	m_inverse(0)
+{
+	if (modulus <= InfInt::zero)
+		throw std::domain_error("InfModIntContext::InfModIntContext(const InfInt& modulus): must have modulus > 0 (modulus=" + modulus.str() + ")");
+	this->m_words = modulus.to_words<word_type>();
+	std::size_t n = this->m_words.size();
+	this->m_zero.assign(n, 0);
+	this->m_one = this->m_zero;
+
+	if (this->montgomery()) {
+		this->m_inverse = 0 - InfInt::word_inverse(this->m_words[0]);
+		// R^2 = 2^(64 n) by modular doublings, then R = REDC(R^2, 1)
+		words_type unit = this->m_zero;
+		unit[0] = 1;
+		this->m_r2 = modulus == InfInt::pos_one ? this->m_zero : unit;
+		for (std::size_t i = 0; i < 64 * n; ++i)
+			this->m_r2 = this->add(this->m_r2, this->m_r2);
+		this->m_one = this->redc(this->m_r2, unit);
+	} else {
+		this->m_mu = ((InfInt::pos_one << (64 * n)) / modulus).to_words<word_type>();
+		if (modulus != InfInt::pos_one)
+			this->m_one[0] = 1;
+	}
+}
+
+InfModIntContext::~InfModIntContext(void) {
+	//
+}
+
+const InfInt& InfModIntContext::modulus(void) const {
+	return this->m_modulus;
+}
+
+bool InfModIntContext::montgomery(void) const {
+	return this->m_words[0] & 1;
+}
+
+// montgomery: |a| is read as n words digits c_k in base R and folded from
+// the top as form = form R + c_k R, both products being one REDC by R^2
+InfModIntContext::words_type InfModIntContext::to_form(const InfInt& a) const {
+	if (!this->montgomery()) {
+		words_type words = InfIntMath::modulo(a, this->m_modulus).to_words<word_type>();
+		words.resize(this->m_words.size(), 0);
+		return words;
+	}
+	std::size_t n = this->m_words.size();
+	words_type words = a.to_words<word_type>();
+	words.resize((words.size() + n - 1) / n * n, 0);
+	words_type form = this->m_zero;
+	for (std::size_t k = words.size(); k > 0; k -= n) {
+		words_type digit(words.begin() + static_cast<long long>(k - n), words.begin() + static_cast<long long>(k));
+		form = this->add(this->redc(form, this->m_r2), this->redc(digit, this->m_r2));
+	}
+	return a.sign() ? this->subtract(this->m_zero, form) : form;
+}
+
+InfInt InfModIntContext::from_form(const words_type& a) const {
+	if (!this->montgomery())
+		return InfInt::from_words(a);
+	words_type unit = this->m_zero;
+	unit[0] = 1;
+	return InfInt::from_words(this->redc(a, unit));
+}
+
+const InfModIntContext::words_type& InfModIntContext::zero(void) const {
+	return this->m_zero;
+}
+
+const InfModIntContext::words_type& InfModIntContext::one(void) const {
+	return this->m_one;
+}
+
+InfModIntContext::words_type InfModIntContext::add(const words_type& a, const words_type& b) const {
+	words_type sum = a;
+	word_type carry = add_in_place(sum, b);
+	reduce_once(sum, this->m_words, carry);
+	return sum;
+}
+
+InfModIntContext::words_type InfModIntContext::subtract(const words_type& a, const words_type& b) const {
+	words_type difference = a;
+	word_type mask = 0 - static_cast<word_type>(subtract_in_place(difference, b)); // 0 or all ones
+	words_type correction = this->m_words;
+	for (word_type& word : correction)
+		word &= mask;
+	add_in_place(difference, correction);
+	return difference;
+}
+
+InfModIntContext::words_type InfModIntContext::multiply(const words_type& a, const words_type& b) const {
+	return this->montgomery() ? this->redc(a, b) : this->barrett(a, b);
+}
+
+// a b / R mod modulus, interleaving the product with the reduction one
+// word of b at a time (CIOS)
+InfModIntContext::words_type InfModIntContext::redc(const words_type& a, const words_type& b) const {
+	std::size_t n = this->m_words.size();
+	words_type t(n + 2, 0);
+	for (std::size_t i = 0; i < n; ++i) {
+		std::uint64_t carry = 0;
+		for (std::size_t j = 0; j < n; ++j) {
+			std::uint64_t s = t[j] + static_cast<std::uint64_t>(a[j]) * b[i] + carry;
+			t[j] = static_cast<word_type>(s);
+			carry = s >> 32;
+		}
+		std::uint64_t s = t[n] + carry;
+		t[n] = static_cast<word_type>(s);
+		t[n + 1] = static_cast<word_type>(s >> 32);
+
+		word_type m = t[0] * this->m_inverse;
+		carry = (t[0] + static_cast<std::uint64_t>(m) * this->m_words[0]) >> 32;
+		for (std::size_t j = 1; j < n; ++j) {
+			s = t[j] + static_cast<std::uint64_t>(m) * this->m_words[j] + carry;
+			t[j - 1] = static_cast<word_type>(s);
+			carry = s >> 32;
+		}
+		s = t[n] + carry;
+		t[n - 1] = static_cast<word_type>(s);
+		t[n] = t[n + 1] + static_cast<word_type>(s >> 32);
+	}
+	word_type overflow = t[n];
+	t.resize(n);
+	reduce_once(t, this->m_words, overflow);
+	return t;
+}
+
+// x = a b < b^2n with b = 2^32: q = (x / b^(n-1)) mu / b^(n+1) is at most
+// two below x / modulus, so r = x - q modulus needs at most two corrections
+InfModIntContext::words_type InfModIntContext::barrett(const words_type& a, const words_type& b) const {
+	std::size_t n = this->m_words.size();
+	words_type x = product(a, b);
+	words_type q(x.begin() + static_cast<long long>(n - 1), x.end());
+	q = product(q, this->m_mu);
+	q.erase(q.begin(), q.begin() + static_cast<long long>(std::min(q.size(), n + 1)));
+
+	words_type r(x.begin(), x.begin() + static_cast<long long>(n + 1));
+	words_type qm = product(q, this->m_words);
+	qm.resize(n + 1, 0);
+	subtract_in_place(r, qm); // mod b^(n+1), the true difference is below 3 modulus
+	words_type modulus = this->m_words;
+	modulus.push_back(0);
+	reduce_once(r, modulus, 0);
+	reduce_once(r, modulus, 0);
+	r.resize(n);
+	return r;
+}
+
+InfModIntContext::words_type InfModIntContext::product(const words_type& a, const words_type& b) {
+	words_type p(a.size() + b.size(), 0);
+	for (std::size_t i = 0; i < a.size(); ++i) {
+		std::uint64_t carry = 0;
+		for (std::size_t j = 0; j < b.size(); ++j) {
+			std::uint64_t s = p[i + j] + static_cast<std::uint64_t>(a[i]) * b[j] + carry;
+			p[i + j] = static_cast<word_type>(s);
+			carry = s >> 32;
+		}
+		p[i + b.size()] = static_cast<word_type>(carry);
+	}
+	return p;
+}
+
+bool InfModIntContext::add_in_place(words_type& a, const words_type& b) {
+	std::uint64_t carry = 0;
+	for (std::size_t i = 0; i < a.size(); ++i) {
+		carry += static_cast<std::uint64_t>(a[i]) + (i < b.size() ? b[i] : 0);
+		a[i] = static_cast<word_type>(carry);
+		carry >>= 32;
+	}
+	return carry != 0;
+}
+
+bool InfModIntContext::subtract_in_place(words_type& a, const words_type& b) {
+	word_type borrow = 0;
+	for (std::size_t i = 0; i < a.size(); ++i) {
+		std::uint64_t s = static_cast<std::uint64_t>(i < b.size() ? b[i] : 0) + borrow;
+		borrow = a[i] < s;
+		a[i] = static_cast<word_type>(a[i] - s);
+	}
+	return borrow != 0;
+}
+
+// a carry word above a makes it at least b. The first pass only finds the
+// borrow of a - b, the second subtracts b under a mask, so both cases run
+// the same instructions and nothing is allocated
+void InfModIntContext::reduce_once(words_type& a, const words_type& b, word_type carry) {
+	word_type borrow = 0;
+	for (std::size_t i = 0; i < a.size(); ++i)
+		borrow = a[i] < static_cast<std::uint64_t>(i < b.size() ? b[i] : 0) + borrow;
+	word_type mask = 0 - (carry | (borrow ^ 1)); // 0 or all ones
+	borrow = 0;
+	for (std::size_t i = 0; i < a.size(); ++i) {
+		std::uint64_t s = static_cast<std::uint64_t>((i < b.size() ? b[i] : 0) & mask) + borrow;
+		borrow = a[i] < s;
+		a[i] = static_cast<word_type>(a[i] - s);
+	}
+}
+
+
+
+InfModInt::InfModInt(const Context& context):
+	m_context(context),
+	m_form(context->zero())
+{
+	//
+}
+
+InfModInt::InfModInt(const InfInt& value, const Context& context):
+	m_context(context),
+	m_form(context->to_form(value))
+{
+	//
+}
+
+InfModInt::InfModInt(const InfInt& value, const InfInt& modulus):
+	InfModInt(value, InfModInt::context(modulus))
+{
+	//
+}
+
+InfModInt::InfModInt(const InfModIntContext::words_type& form, const Context& context):
+	m_context(context),
+	m_form(form)
+{
+	//
+}
+
+InfModInt::Context InfModInt::context(const InfInt& modulus) {
+	return std::make_shared<const InfModIntContext>(modulus);
+}
+
+const InfModInt::Context& InfModInt::context(void) const {
+	return this->m_context;
+}
+
+const InfInt& InfModInt::modulus(void) const {
+	return this->m_context->modulus();
+}
+
+InfInt InfModInt::value(void) const {
+	return this->m_context->from_form(this->m_form);
+}
+
+std::string InfModInt::str(void) const {
+	return this->value().str();
+}
+
+InfModInt InfModInt::inverse(void) const {
+	return InfModInt(InfIntMath::modinv(this->value(), this->modulus()), this->m_context);
+}
+
+InfModInt InfModInt::pow(const InfInt& e) const {
+	if (e.sign())
+		return this->inverse().pow(-e);
+	InfModIntContext::words_type r = this->m_context->one();
+	for (InfInt::size_type i = e.size(); i-- > 0;) {
+		r = this->m_context->multiply(r, r);
+		if (e.get(i))
+			r = this->m_context->multiply(r, this->m_form);
+	}
+	return InfModInt(r, this->m_context);
+}
+
+// Montgomery ladder: every exponent bit costs one multiply and one square,
+// and the bit only ever reaches the arithmetic through a masked swap; a fixed
+// number of bits is walked so the length of e does not leak either. The
+// reductions themselves end in a masked subtraction, see reduce_once
+InfModInt InfModInt::pow_ladder(const InfInt& e) const {
+	if (e.sign())
+		return this->inverse().pow_ladder(-e);
+	InfInt::size_type bits = e.size() < this->modulus().size() ? this->modulus().size() : e.size();
+	InfModIntContext::words_type exponent = exponent_bits(e, bits);
+	InfModIntContext::words_type r0 = this->m_context->one();
+	InfModIntContext::words_type r1 = this->m_form;
+
+	for (InfInt::size_type i = bits; i-- > 0;) {
+		InfModIntContext::word_type mask = 0 - ((exponent[i / 32] >> (i % 32)) & 1); // 0 or all ones
+		for (std::size_t j = 0; j < r0.size(); ++j) {
+			InfModIntContext::word_type swap = (r0[j] ^ r1[j]) & mask;
+			r0[j] ^= swap;
+			r1[j] ^= swap;
+		}
+		r1 = this->m_context->multiply(r0, r1);
+		r0 = this->m_context->multiply(r0, r0);
+		for (std::size_t j = 0; j < r0.size(); ++j) {
+			InfModIntContext::word_type swap = (r0[j] ^ r1[j]) & mask;
+			r0[j] ^= swap;
+			r1[j] ^= swap;
+		}
+	}
+	return InfModInt(r0, this->m_context);
+}
+
+// fixed 4 bits windows: every window costs four squares and one product by
+// a table entry, read by scanning the whole table under a mask, so neither
+// the operations nor the memory accesses depend on the bits of e, down to
+// the masked subtraction that ends every reduction. That is
+// about 1.25 products per bit against 2 for the ladder and 1.5 on average
+// for pow
+InfModInt InfModInt::pow_window(const InfInt& e) const {
+	if (e.sign())
+		return this->inverse().pow_window(-e);
+	const InfInt::size_type window = 4;
+	const std::size_t entries = 1 << window;
+	std::vector<InfModIntContext::words_type> table(entries);
+	table[0] = this->m_context->one();
+	for (std::size_t i = 1; i < entries; ++i)
+		table[i] = this->m_context->multiply(table[i - 1], this->m_form);
+
+	InfInt::size_type bits = e.size() < this->modulus().size() ? this->modulus().size() : e.size();
+	bits = (bits + window - 1) / window * window;
+	InfModIntContext::words_type exponent = exponent_bits(e, bits);
+	InfModIntContext::words_type r = this->m_context->one();
+	InfModIntContext::words_type entry(r.size());
+	for (InfInt::size_type i = bits; i > 0; i -= window) {
+		for (InfInt::size_type j = 0; j < window; ++j)
+			r = this->m_context->multiply(r, r);
+		std::size_t digit = 0;
+		for (InfInt::size_type j = 0; j < window; ++j)
+			digit |= static_cast<std::size_t>((exponent[(i - window + j) / 32] >> ((i - window + j) % 32)) & 1) << j;
+		for (std::size_t k = 0; k < entry.size(); ++k)
+			entry[k] = 0;
+		for (std::size_t t = 0; t < entries; ++t) {
+			InfModIntContext::word_type mask = 0 - static_cast<InfModIntContext::word_type>(t == digit); // 0 or all ones
+			for (std::size_t k = 0; k < entry.size(); ++k)
+				entry[k] |= table[t][k] & mask;
+		}
+		r = this->m_context->multiply(r, entry);
+	}
+	return InfModInt(r, this->m_context);
+}
+
+// the positions past e.size() read its top bit masked out, so get never
+// takes its out of range branch and the loop length only depends on bits
+InfModIntContext::words_type InfModInt::exponent_bits(const InfInt& e, InfInt::size_type bits) {
+	InfModIntContext::words_type words(bits / 32 + 1, 0);
+	InfInt::size_type last = e.size() - 1;
+	for (InfInt::size_type i = 0; i < bits; ++i) {
+		InfModIntContext::word_type inside = 0 - static_cast<InfModIntContext::word_type>(i <= last); // 0 or all ones
+		words[i / 32] |= (static_cast<InfModIntContext::word_type>(e.get(std::min(i, last))) & inside) << (i % 32);
+	}
+	return words;
+}
+
+void InfModInt::check(const InfModInt& other) const {
+	if (this->m_context != other.m_context && this->modulus() != other.modulus())
+		throw std::invalid_argument("void InfModInt::check(const InfModInt& other) const: moduli differ (" + this->modulus().str() + " and " + other.modulus().str() + ")");
+}
+
+bool InfModInt::operator==(const InfModInt& other) const {
+	this->check(other);
+	return this->m_form == other.m_form;
+}
+
+bool InfModInt::operator!=(const InfModInt& other) const {
+	return !(*this == other);
+}
+
+InfModInt InfModInt::operator-(void) const {
+	return InfModInt(this->m_context->subtract(this->m_context->zero(), this->m_form), this->m_context);
+}
+
+InfModInt InfModInt::operator+(const InfModInt& other) const {
+	this->check(other);
+	return InfModInt(this->m_context->add(this->m_form, other.m_form), this->m_context);
+}
+
+InfModInt& InfModInt::operator+=(const InfModInt& other) {
+	*this = *this + other;
+	return *this;
+}
+
+InfModInt InfModInt::operator-(const InfModInt& other) const {
+	this->check(other);
+	return InfModInt(this->m_context->subtract(this->m_form, other.m_form), this->m_context);
+}
+
+InfModInt& InfModInt::operator-=(const InfModInt& other) {
+	*this = *this - other;
+	return *this;
+}
+
+InfModInt InfModInt::operator*(const InfModInt& other) const {
+	this->check(other);
+	return InfModInt(this->m_context->multiply(this->m_form, other.m_form), this->m_context);
+}
+
+InfModInt& InfModInt::operator*=(const InfModInt& other) {
+	*this = *this * other;
+	return *this;
+}
+
+InfModInt InfModInt::operator/(const InfModInt& other) const {
+	return *this * other.inverse();
+}
+
+InfModInt& InfModInt::operator/=(const InfModInt& other) {
+	*this = *this / other;
+	return *this;
+}
+
+std::ostream& operator<<(std::ostream& out, const InfModInt& infmodint) {
+	out << infmodint.str();
+	return out;
+}
+
+#endif // INFMODINT_HPP
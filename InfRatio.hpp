@@ -171,7 +171,7 @@ InfRatio InfRatio::operator+(const InfRatio& other) const {
 InfRatio& InfRatio::operator+=(const InfRatio& other) {
 	if (this->divisor() != other.divisor()) {
 		InfInt lcm = InfIntMath::lcm(this->divisor(), other.divisor());
-		this->m_numerator = this->numerator() * (lcm / this->divisor()) + other.numerator() * (lcm / other.divisor());
+		this->m_numerator = this->numerator() * InfInt::divexact(lcm, this->divisor()) + other.numerator() * InfInt::divexact(lcm, other.divisor());
 		this->m_divisor = lcm;
 	} else
 		this->m_numerator += other.numerator();
@@ -196,7 +196,7 @@ InfRatio InfRatio::operator-(const InfRatio& other) const {
 InfRatio& InfRatio::operator-=(const InfRatio& other) {
 	if (this->divisor() != other.divisor()) {
 		InfInt lcmVal = InfIntMath::lcm(this->divisor(), other.divisor());
-		this->m_numerator = this->numerator() * (lcmVal / this->divisor()) - other.numerator() * (lcmVal / other.divisor());
+		this->m_numerator = this->numerator() * InfInt::divexact(lcmVal, this->divisor()) - other.numerator() * InfInt::divexact(lcmVal, other.divisor());
 		this->m_divisor = lcmVal;
 	}
 	else
@@ -226,7 +226,7 @@ bool InfRatio::operator!=(const InfRatio& other) const {
 bool InfRatio::operator>(const InfRatio& other) const {
 	if (this->divisor() != other.divisor()) {
 		InfInt lcm = InfIntMath::lcm(this->divisor(), other.divisor());
-		return this->numerator() * (lcm / this->divisor()) > other.numerator() * (lcm / other.divisor());
+		return this->numerator() * InfInt::divexact(lcm, this->divisor()) > other.numerator() * InfInt::divexact(lcm, other.divisor());
 	}
 	else
 		return this->numerator() > other.numerator();
@@ -235,7 +235,7 @@ bool InfRatio::operator>(const InfRatio& other) const {
 bool InfRatio::operator<(const InfRatio& other) const {
 	if (this->divisor() != other.divisor()) {
 		InfInt lcm = InfIntMath::lcm(this->divisor(), other.divisor());
-		return this->numerator() * (lcm / this->divisor()) < other.numerator() * (lcm / other.divisor());
+		return this->numerator() * InfInt::divexact(lcm, this->divisor()) < other.numerator() * InfInt::divexact(lcm, other.divisor());
 	}
 	else
 		return this->numerator() < other.numerator();
@@ -244,7 +244,7 @@ bool InfRatio::operator<(const InfRatio& other) const {
 bool InfRatio::operator>=(const InfRatio& other) const {
 	if (m_divisor != other.divisor()) {
 		InfInt lcm = InfIntMath::lcm(this->divisor(), other.divisor());
-		return this->numerator() * (lcm / this->divisor()) >= other.numerator() * (lcm / other.divisor());
+		return this->numerator() * InfInt::divexact(lcm, this->divisor()) >= other.numerator() * InfInt::divexact(lcm, other.divisor());
 	}
 	else
 		return this->numerator() >= other.numerator();
@@ -253,7 +253,7 @@ bool InfRatio::operator>=(const InfRatio& other) const {
 bool InfRatio::operator<=(const InfRatio& other) const {
 	if (this->divisor() != other.divisor()) {
 		InfInt lcm = InfIntMath::lcm(this->divisor(), other.divisor());
-		return this->numerator() * (lcm / this->divisor()) <= other.numerator() * (lcm / other.divisor());
+		return this->numerator() * InfInt::divexact(lcm, this->divisor()) <= other.numerator() * InfInt::divexact(lcm, other.divisor());
 	}
 	else
 		return this->numerator() <= other.numerator();
@@ -270,10 +270,12 @@ InfRatio& InfRatio::simplify(void) {
 		throw std::invalid_argument("Divisor can not be 0 !");
 	if (this->numerator() == InfInt::zero)
 		this->m_divisor = InfInt::pos_one;
-	else {
+	else if (this->divisor() != InfInt::pos_one) {
 		InfInt gcd = InfIntMath::gcd(this->m_numerator, this->m_divisor);
-		this->m_numerator /= gcd;
-		this->m_divisor /= gcd;
+		if (gcd != InfInt::pos_one) {
+			this->m_numerator = InfInt::divexact(this->m_numerator, gcd);
+			this->m_divisor = InfInt::divexact(this->m_divisor, gcd);
+		}
 	}
 	if (this->divisor() < InfInt::zero) {
 		this->m_numerator.twos_complement();
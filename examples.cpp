@@ -1,23 +1,33 @@
 // std libs
 #include <iostream>
+#include <chrono>
+#include <functional>
+#include <sstream>
 
 // InfInt libs
 #include "InfInt.hpp"
+#include "InfIntCRT.hpp"
 #include "InfIntMath.hpp"
 #include "InfIntRSA.hpp"
 #include "InfIntRandom.hpp"
 #include "InfIntText.hpp"
+#include "InfModInt.hpp"
 
 // InfRatio libs
 #include "InfRatio.hpp"
 #include "InfRatioMath.hpp"
 
 void operators_tests(void);
+void primality_tests(void);
+void gcd_tests(void);
+void math_tests(void);
+void rsa_tests(void);
 void exemple_text(void);
 void exemple_prime(void);
 void exemple_random(void);
 void exemple_ratio(void);
 void exemple_rsa(void);
+void benchmarks(void);
 
 int main(void) {
 	std::cout << "/!\\ Start /!\\" << std::endl << std::endl;
@@ -25,11 +35,16 @@ int main(void) {
 	// comment out exemples you don't want to execute
 
 	operators_tests();
+	primality_tests();
+	gcd_tests();
+	math_tests();
+	rsa_tests();
 	exemple_text();
 	exemple_prime();
 	exemple_random();
 	exemple_ratio();
 	exemple_rsa();
+	benchmarks();
 
 	std::cout << std::endl << "/!\\ End /!\\, press entrer to continue... "; std::cin.get();
 	return EXIT_SUCCESS;
@@ -46,7 +61,7 @@ void exemple_rsa(void) {
 	if (p == 0)
 		p = 1'754'397'133;
 	else if (p == 1)
-		do { p = rand(); if (!p.get(0)) ++p; } while (!InfIntMath::probable_prime(p));
+		p = InfIntMath::random_prime(512, rand);
 
 	InfInt q;
 	std::cout << "q: ";
@@ -54,7 +69,7 @@ void exemple_rsa(void) {
 	if (q == 0)
 		q = 2'038'064'033;
 	else if (q == 1)
-		do { q = rand(); if (!q.get(0)) ++q; } while (!InfIntMath::probable_prime(q));
+		q = InfIntMath::random_prime(512, rand);
 
 	InfInt min_e;
 	std::cout << "min e: ";
@@ -106,6 +121,81 @@ void exemple_random(void) {
 		std::cout << "0: " << count_zero << " | 1: " << count_one << " | size: " << s.size() - 1 << std::endl;
 	}
 
+	std::cout << std::endl << "Testing draws ..." << std::endl;
+	for (InfIntRandomEngine::result_type size : {1u, 31u, 32u, 33u, 64u, 300u}) {
+		InfIntRandomEngine a(size, 49u);
+		InfIntRandomEngine b(size, 49u);
+		InfInt value = -12345; // overwritten, sign included
+		int full_size = 0;
+		for (int i = 0; i < 200; ++i) {
+			InfInt x = a();
+			b(value);
+			if (x != value || x < a.min() || x > a.max())
+				std::cout << "bug: draw of " << size << " bits " << x << " or written: " << value << std::endl;
+			if (x.get(size - 1))
+				++full_size;
+		}
+		// the top bit is set half of the time
+		if (full_size < 60 || full_size > 140)
+			std::cout << "bug: " << full_size << " draws of 200 have their top bit set for " << size << " bits" << std::endl;
+	}
+	std::cout << "Finished testing draws" << std::endl << std::endl;
+
+	std::cout << "Testing shaped draws ..." << std::endl;
+	InfIntRandomEngine shaped(64, 50u);
+	const InfInt bounds[] = {1, 2, 3, 10, InfInt::pos_one << 32, (InfInt::pos_one << 32) + InfInt::pos_one, (InfInt::pos_one << 100) - 3_infint, InfInt::pos_one << 300};
+	for (const InfInt& bound : bounds) {
+		std::vector<int> counts(10, 0);
+		for (int i = 0; i < 500; ++i) {
+			InfInt x = shaped.uniform_below(bound);
+			if (x < InfInt::zero || x >= bound)
+				std::cout << "bug: uniform_below(" << bound << ") = " << x << std::endl;
+			if (bound <= 10_infint)
+				++counts[x.to_int<int>()];
+			InfInt lo = bound - (InfInt::pos_one << 40);
+			InfInt y = shaped.uniform_range(lo, bound);
+			if (y < lo || y > bound)
+				std::cout << "bug: uniform_range(" << lo << ", " << bound << ") = " << y << std::endl;
+		}
+		// every value turns up about 500 / bound times
+		for (int v = 0; bound <= 10_infint && v < bound.to_int<int>(); ++v)
+			if (counts[v] < 250 / bound.to_int<int>() || counts[v] > 1000 / bound.to_int<int>())
+				std::cout << "bug: uniform_below(" << bound << ") gave " << v << " " << counts[v] << " times of 500" << std::endl;
+	}
+	if (shaped.uniform_range(7, 7) != 7_infint || shaped.uniform_range(-3, -3) != -3_infint)
+		std::cout << "bug: uniform_range over a single value" << std::endl;
+	for (InfInt::size_type bits : {1u, 2u, 31u, 32u, 33u, 64u, 65u, 300u}) {
+		for (int i = 0; i < 50; ++i) {
+			InfInt odd = shaped.random_odd(bits);
+			if (odd.size() != bits || !odd.get(0))
+				std::cout << "bug: random_odd(" << bits << ") = " << odd << std::endl;
+			for (InfInt::size_type top = 1; top <= std::min<InfInt::size_type>(bits, 3); ++top) {
+				InfInt x = shaped.random_with_top_bits(bits, top);
+				bool set = x.size() == bits;
+				for (InfInt::size_type j = bits - top; j < bits; ++j)
+					set = set && x.get(j);
+				if (!set)
+					std::cout << "bug: random_with_top_bits(" << bits << ", " << top << ") = " << x << std::endl;
+			}
+			if (bits >= 2) {
+				InfInt product = shaped.random_with_top_bits(bits) * shaped.random_with_top_bits(bits);
+				if (product.size() != 2 * bits)
+					std::cout << "bug: product of two random_with_top_bits(" << bits << ") has " << product.size() << " bits" << std::endl;
+			}
+		}
+	}
+	try {
+		shaped.uniform_below(0);
+		std::cout << "bug: uniform_below(0) should throw" << std::endl;
+	} catch (const std::invalid_argument&) {
+	}
+	try {
+		shaped.uniform_range(2, 1);
+		std::cout << "bug: uniform_range(2, 1) should throw" << std::endl;
+	} catch (const std::invalid_argument&) {
+	}
+	std::cout << "Finished testing shaped draws" << std::endl << std::endl;
+
 	std::cout << "End Exemple Random, press entrer to continue... "; std::cin.get();
 	std::cout << std::endl << std::endl << std::endl;
 }
@@ -114,12 +204,7 @@ void exemple_prime(void) {
 	std::cout << "Start Exemple Prime" << std::endl << std::endl;
 
 	InfIntRandomEngine infg(1024);
-	InfInt n;
-	do {
-		std::cout << std::endl;
-		n = infg();
-		if (!n.get(0)) ++n;
-	} while (!InfIntMath::probable_prime(n));
+	InfInt n = InfIntMath::random_prime(1024, infg);
 
 	std::cout << std::endl << std::endl;
 	std::cout << "Result: " << n << std::endl;
@@ -140,7 +225,7 @@ void exemple_text(void) {
 	if (p == 0)
 		p = 1'754'397'133;
 	else if (p == 1)
-		do { p = rand(); if (!p.get(0)) ++p; } while (!InfIntMath::probable_prime(p));
+		p = InfIntMath::random_prime(1024, rand);
 
 	InfInt q;
 	std::cout << "q: ";
@@ -148,7 +233,7 @@ void exemple_text(void) {
 	if (q == 0)
 		q = 2'038'064'033;
 	else if (q == 1)
-		do { q = rand(); if (!q.get(0)) ++q; } while (!InfIntMath::probable_prime(q));
+		q = InfIntMath::random_prime(1024, rand);
 
 	InfInt min_e;
 	std::cout << "min e: ";
@@ -265,6 +350,819 @@ void operators_tests(void) {
 	}
 	std::cout << "Finished testing fulldiv" << std::endl << std::endl;
 
+	std::cout << "Testing divexact and divisible_by ..." << std::endl;
+	for (int i = min; i < max; ++i) {
+		for (int j = min; j < max; ++j) {
+			bool divisible = j == 0 ? i == 0 : i % j == 0;
+			if (InfInt::divisible_by(i, j) != divisible)
+				std::cout << "bug: divisible_by(" << i << ", " << j << ") = " << divisible << std::endl;
+			if (j != 0 && divisible && InfInt::divexact(i, j).to_int_safe<int>() != i / j)
+				std::cout << "bug: divexact(" << i << ", " << j << ") = " << i / j << " or getting: " << InfInt::divexact(i, j).to_int_safe<int>() << std::endl;
+		}
+	}
+	InfIntRandomEngine rand(256, 43u);
+	for (int i = 0; i < 40; ++i) {
+		InfInt q = rand() >> (i * 7 % 250);
+		InfInt b = ((rand() >> (i * 11 % 250)) | InfInt::pos_one) << (i * 3 % 70); // trailing zero bits
+		if (i % 2)
+			q = -q;
+		if (i % 3)
+			b = -b;
+		InfInt a = q * b;
+		if (InfInt::divexact(a, b) != q || !InfInt::divisible_by(a, b))
+			std::cout << "bug: divexact(" << a << ", " << b << ") = " << q << " or getting: " << InfInt::divexact(a, b) << std::endl;
+		if (b != InfInt::pos_one && b != InfInt::neg_one && (InfInt::divisible_by(a + InfInt::pos_one, b) || InfInt::divisible_by(a + (b >> 1), b)))
+			std::cout << "bug: " << b << " does not divide " << a << " + 1 or " << a << " + " << (b >> 1) << std::endl;
+	}
+	try {
+		InfInt::divexact(1, 0);
+		std::cout << "bug: divexact(1, 0) should throw" << std::endl;
+	} catch (const std::domain_error&) {
+	}
+	std::cout << "Finished testing divexact and divisible_by" << std::endl << std::endl;
+
 	std::cout << "End Operators' Tests, press entrer to continue... "; std::cin.get();
 	std::cout << std::endl << std::endl << std::endl;
 }
+
+void primality_tests(void) {
+	std::cout << "Start Primality Tests" << std::endl << std::endl;
+
+	// strong pseudoprimes to base 2, caught by the Lucas half of Baillie-PSW
+	const unsigned long long spsp2[] = {2047, 3277, 4033, 4681, 8321, 15841, 29341, 42799, 49141, 52633, 65281, 74665, 80581, 85489, 88357, 90751, 3215031751ull};
+	// strong Lucas pseudoprimes, caught by the base 2 half
+	const unsigned long long slpsp[] = {5459, 5777, 10877, 16109, 18971, 22499, 24569, 25199, 40309, 58519, 75077, 97439};
+	// Carmichael numbers
+	const unsigned long long carmichael[] = {561, 1105, 1729, 2465, 2821, 6601, 8911, 41041, 825265, 321197185, 5394826801ull};
+	const InfInt primes[] = {
+		2, 3, 5, 7919, 7927, 65537, 2147483647, 18446744073709551557ull,
+		(InfInt::pos_one << 61) - InfInt::pos_one,
+		(InfInt::pos_one << 89) - InfInt::pos_one,
+		(InfInt::pos_one << 127) - InfInt::pos_one,
+		InfInt("170141183460469231731687303715884105727", 10)
+	};
+
+	std::cout << "Testing strong pseudoprimes ..." << std::endl;
+	for (unsigned long long n : spsp2) {
+		if (!InfIntMath::probable_prime_base(n, 2))
+			std::cout << "bug: " << n << " should pass the base 2 strong test" << std::endl;
+		if (InfIntMath::strong_lucas_probable_prime(n) || InfIntMath::probable_prime(n) || InfIntMath::miller_rabin(n, 8))
+			std::cout << "bug: " << n << " is composite" << std::endl;
+	}
+	for (unsigned long long n : slpsp) {
+		if (!InfIntMath::strong_lucas_probable_prime(n))
+			std::cout << "bug: " << n << " should pass the strong Lucas test" << std::endl;
+		if (InfIntMath::probable_prime_base(n, 2) || InfIntMath::probable_prime(n) || InfIntMath::miller_rabin(n, 8))
+			std::cout << "bug: " << n << " is composite" << std::endl;
+	}
+	for (unsigned long long n : carmichael)
+		if (InfIntMath::probable_prime(n) || InfIntMath::miller_rabin(n, 8))
+			std::cout << "bug: " << n << " is composite" << std::endl;
+	std::cout << "Finished testing strong pseudoprimes" << std::endl << std::endl;
+
+	std::cout << "Testing primes ..." << std::endl;
+	for (const InfInt& p : primes) {
+		if (!InfIntMath::probable_prime(p) || !InfIntMath::miller_rabin(p, 8))
+			std::cout << "bug: " << p << " is prime" << std::endl;
+		if (p > 3 && InfIntMath::probable_prime(p * p))
+			std::cout << "bug: " << p << "^2 is composite" << std::endl;
+	}
+	std::cout << "Finished testing primes" << std::endl << std::endl;
+
+	std::cout << "Testing against a sieve ..." << std::endl;
+	const int limit = 10000;
+	std::vector<bool> sieve(limit, true);
+	sieve[0] = sieve[1] = false;
+	for (int i = 2; i * i < limit; ++i)
+		if (sieve[i])
+			for (int j = i * i; j < limit; j += i)
+				sieve[j] = false;
+	for (int n = 0; n < limit; ++n) {
+		if (InfIntMath::probable_prime(n) != sieve[n])
+			std::cout << "bug: probable_prime(" << n << ") = " << !sieve[n] << std::endl;
+		if (InfIntMath::miller_rabin(n, 8) != sieve[n])
+			std::cout << "bug: miller_rabin(" << n << ") = " << !sieve[n] << std::endl;
+		if (n > 2 && sieve[n] && !InfIntMath::strong_lucas_probable_prime(n))
+			std::cout << "bug: strong_lucas_probable_prime(" << n << ") = 0" << std::endl;
+		if (n > 4 && sieve[n] && !InfIntMath::probable_prime_base(n, 2))
+			std::cout << "bug: probable_prime_base(" << n << ", 2) = 0" << std::endl;
+	}
+	std::cout << "Finished testing against a sieve" << std::endl << std::endl;
+
+	std::cout << "Testing parallel_random_prime ..." << std::endl;
+	for (InfInt::size_type bits : {2u, 3u, 17u, 18u, 33u, 128u, 512u}) {
+		for (InfIntRandomEngine::result_type seed = 1; seed <= 3; ++seed) {
+			InfInt::size_type top = bits > 3 ? 2 : 1;
+			// the same stream as the one the windows are drawn from
+			std::seed_seq seq{seed};
+			InfIntRandomEngine engine(static_cast<InfIntRandomEngine::result_type>(bits), seq);
+			InfInt expected = InfIntMath::random_prime(bits, engine, top);
+			if (expected.size() != bits || !expected.get(bits - top) || !InfIntMath::probable_prime(expected))
+				std::cout << "bug: random_prime(" << bits << ", engine, " << top << ") = " << expected << std::endl;
+			for (unsigned threads : {1u, 2u, 3u, 4u, 8u}) {
+				InfInt p = InfIntMath::parallel_random_prime(bits, threads, seed, top);
+				if (p != expected)
+					std::cout << "bug: parallel_random_prime(" << bits << ", " << threads << ", " << seed << ", " << top << ") = " << p << " or expecting: " << expected << std::endl;
+			}
+		}
+	}
+	std::cout << "Finished testing parallel_random_prime" << std::endl << std::endl;
+
+	std::cout << "End Primality Tests, press entrer to continue... "; std::cin.get();
+	std::cout << std::endl << std::endl << std::endl;
+}
+
+// the plain remainder sequence the word level algorithms replaced
+InfInt euclid(InfInt a, InfInt b) {
+	a = InfIntMath::abs(a);
+	b = InfIntMath::abs(b);
+	while (b != InfInt::zero) {
+		InfInt r = a % b;
+		a = std::move(b);
+		b = std::move(r);
+	}
+	return a;
+}
+
+void gcd_tests(void) {
+	std::cout << "Start GCD Tests" << std::endl << std::endl;
+
+	InfIntRandomEngine rand(512, 27u);
+
+	std::cout << "Testing gcd ..." << std::endl;
+	for (int i = -20; i <= 20; ++i)
+		for (int j = -20; j <= 20; ++j)
+			if (InfIntMath::gcd(i, j) != euclid(i, j))
+				std::cout << "bug: gcd(" << i << ", " << j << ") = " << euclid(i, j) << " or getting: " << InfIntMath::gcd(i, j) << std::endl;
+	for (int i = 0; i < 40; ++i) {
+		InfInt g = rand() >> (i * 11 % 500);
+		InfInt a = (rand() >> (i * 7 % 300)) * g;
+		InfInt b = (rand() >> (i * 13 % 300)) * g;
+		if (i % 3 == 0)
+			a = -a;
+		if (InfIntMath::gcd(a, b) != euclid(a, b))
+			std::cout << "bug: gcd(" << a << ", " << b << ") = " << euclid(a, b) << " or getting: " << InfIntMath::gcd(a, b) << std::endl;
+		std::uint64_t x = (rand() >> 448).to_int<std::uint64_t>();
+		std::uint64_t y = (rand() >> (448 + i)).to_int<std::uint64_t>();
+		if (InfInt(InfIntMath::binary_gcd(x, y)) != euclid(InfInt(x), InfInt(y)))
+			std::cout << "bug: binary_gcd(" << x << ", " << y << ") = " << euclid(InfInt(x), InfInt(y)) << " or getting: " << InfIntMath::binary_gcd(x, y) << std::endl;
+	}
+	std::cout << "Finished testing gcd" << std::endl << std::endl;
+
+	std::cout << "Testing egcd and modinv ..." << std::endl;
+	for (int i = 0; i < 40; ++i) {
+		InfInt a = rand() >> (i * 7 % 500);
+		InfInt m = (rand() >> (i * 11 % 500)) + 2_infint;
+		if (i % 2)
+			a = -a;
+		InfIntEGCDResult e = InfIntMath::egcd(a, m);
+		InfInt expected = euclid(a, m);
+		if (e.gcd() != expected || e.x() * a + e.y() * m != expected)
+			std::cout << "bug: egcd(" << a << ", " << m << ") = " << e.gcd() << ", " << e.x() << ", " << e.y() << std::endl;
+		try {
+			InfInt inverse = InfIntMath::modinv(a, m);
+			if (expected != InfInt::pos_one || inverse < InfInt::zero || inverse >= m || InfIntMath::modulo(inverse * a, m) != InfInt::pos_one)
+				std::cout << "bug: modinv(" << a << ", " << m << ") = " << inverse << std::endl;
+		} catch (const std::domain_error&) {
+			if (expected == InfInt::pos_one)
+				std::cout << "bug: modinv(" << a << ", " << m << ") should exist" << std::endl;
+		}
+	}
+	std::cout << "Finished testing egcd and modinv" << std::endl << std::endl;
+
+	std::cout << "Testing batch_modinv ..." << std::endl;
+	{
+		// 3 * 5 * 7 * 11 * 13 * a 256 bit odd number, about one value in four has no inverse
+		InfInt m = 15015_infint * ((rand() >> 256) | InfInt::pos_one);
+		std::vector<InfInt> values;
+		std::vector<std::size_t> expected_failed;
+		for (int i = 0; i < 200; ++i) {
+			values.push_back(i % 7 == 3 ? InfInt::zero : (rand() >> (256 + i % 200)) * (i % 5 == 0 ? InfInt(3 + 2 * (i % 3)) : InfInt::pos_one));
+			if (i % 11 == 0)
+				values.back() = -values.back();
+			if (euclid(values.back(), m) != InfInt::pos_one)
+				expected_failed.push_back(static_cast<std::size_t>(i));
+		}
+
+		InfIntBatchModinvResult serial = InfIntMath::batch_modinv(values, m);
+		if (serial.failed() != expected_failed)
+			std::cout << "bug: batch_modinv reports " << serial.failed().size() << " failed indices instead of " << expected_failed.size() << std::endl;
+		for (std::size_t i = 0; i < values.size(); ++i) {
+			bool invertible = !std::binary_search(expected_failed.begin(), expected_failed.end(), i);
+			if (invertible && serial.inverses()[i] != InfIntMath::modinv(values[i], m))
+				std::cout << "bug: batch_modinv(" << values[i] << ", " << m << ") = " << serial.inverses()[i] << std::endl;
+			if (!invertible && serial.inverses()[i] != InfInt::zero)
+				std::cout << "bug: batch_modinv(" << values[i] << ", " << m << ") = " << serial.inverses()[i] << " without inverse" << std::endl;
+		}
+
+		// the span overload appends to failed and leaves the failed slots alone
+		std::vector<InfInt> inverses(values.size(), -InfInt::pos_one);
+		std::vector<std::size_t> failed = {1000};
+		InfIntMath::batch_modinv(values, m, inverses, failed);
+		if (failed.size() != expected_failed.size() + 1 || failed[0] != 1000 || !std::equal(expected_failed.begin(), expected_failed.end(), failed.begin() + 1))
+			std::cout << "bug: batch_modinv(values, m, inverses, failed) reports the wrong failed indices" << std::endl;
+		for (std::size_t i = 0; i < values.size(); ++i)
+			if (inverses[i] != (serial.inverses()[i] == InfInt::zero ? -InfInt::pos_one : serial.inverses()[i]))
+				std::cout << "bug: batch_modinv(values, m, inverses, failed) wrote " << inverses[i] << " at " << i << std::endl;
+		try {
+			std::vector<InfInt> short_inverses(values.size() - 1);
+			InfIntMath::batch_modinv(values, m, short_inverses, failed);
+			std::cout << "bug: batch_modinv should throw on a short inverses span" << std::endl;
+		} catch (const std::invalid_argument&) {
+		}
+
+		for (unsigned threads : {1u, 2u, 4u, 7u}) {
+			InfIntBatchModinvResult parallel = InfIntMath::batch_modinv_parallel(values, m, threads);
+			if (parallel.inverses() != serial.inverses() || parallel.failed() != serial.failed())
+				std::cout << "bug: batch_modinv_parallel with " << threads << " threads differs from batch_modinv" << std::endl;
+		}
+		try {
+			InfIntMath::batch_modinv_parallel(values, InfInt::zero, 4);
+			std::cout << "bug: batch_modinv_parallel should rethrow the modulo by 0" << std::endl;
+		} catch (const std::domain_error&) {
+		}
+	}
+	std::cout << "Finished testing batch_modinv" << std::endl << std::endl;
+
+	std::cout << "Testing the half-gcd recursion ..." << std::endl;
+	InfInt::size_type threshold = 128; // real operands only get there above 2^16 bits
+	for (int i = 0; i < 12; ++i) {
+		InfInt g = rand() >> (i * 37 % 500);
+		InfInt a = rand() * rand() * g;
+		InfInt b = (rand() * rand() >> (i * 29 % 400)) * g;
+		if (i % 4 == 0)
+			b = -b;
+		InfInt expected = euclid(a, b);
+		if (InfIntMath::gcd(a, b, threshold) != expected)
+			std::cout << "bug: gcd(" << a << ", " << b << ") = " << expected << " or getting: " << InfIntMath::gcd(a, b, threshold) << std::endl;
+		InfIntEGCDResult e = InfIntMath::egcd(a, b, threshold);
+		if (e.gcd() != expected || e.x() * a + e.y() * b != expected)
+			std::cout << "bug: egcd(" << a << ", " << b << ") = " << e.gcd() << ", " << e.x() << ", " << e.y() << std::endl;
+		if (expected == InfInt::pos_one && InfIntMath::modulo(a * InfIntMath::modinv(a, b, threshold), b) != InfInt::pos_one)
+			std::cout << "bug: modinv(" << a << ", " << b << ") = " << InfIntMath::modinv(a, b, threshold) << std::endl;
+		InfIntHGCDResult h = InfIntMath::hgcd(a, b, threshold);
+		if (h.m00() * a + h.m01() * b != h.a() || h.m10() * a + h.m11() * b != h.b() || h.b().size() > InfIntMath::abs(a).size() / 2 + 1 || euclid(h.a(), h.b()) != expected)
+			std::cout << "bug: hgcd(" << a << ", " << b << ") = " << h.a() << ", " << h.b() << std::endl;
+	}
+	std::cout << "Finished testing the half-gcd recursion" << std::endl << std::endl;
+
+	std::cout << "End GCD Tests, press entrer to continue... "; std::cin.get();
+	std::cout << std::endl << std::endl << std::endl;
+}
+
+// exposes REDC, to run it on inputs that need its final subtraction or not
+class RedcProbe: public InfModIntContext {
+public:
+	RedcProbe(const InfInt& modulus): InfModIntContext(modulus) {}
+	using InfModIntContext::redc;
+};
+
+void math_tests(void) {
+	std::cout << "Start Math Tests" << std::endl << std::endl;
+
+	InfIntRandomEngine rand(512, 35u);
+
+	std::cout << "Testing sqrt and sqrtrem ..." << std::endl;
+	for (int n = 0, r = 0; n < 10000; ++n) {
+		if ((r + 1) * (r + 1) <= n)
+			++r;
+		InfIntSqrtremResult s = InfIntMath::sqrtrem(n);
+		if (s.root() != r || s.remainder() != n - r * r)
+			std::cout << "bug: sqrtrem(" << n << ") = " << r << ", " << n - r * r << " or getting: " << s.root() << ", " << s.remainder() << std::endl;
+		if (InfIntMath::is_perfect_square(n) != (r * r == n))
+			std::cout << "bug: is_perfect_square(" << n << ") = " << (r * r == n) << std::endl;
+	}
+	for (int i = 0; i < 40; ++i) {
+		InfInt n = rand() >> (i * 11 % 500);
+		InfIntSqrtremResult s = InfIntMath::sqrtrem(n);
+		if (s.root() * s.root() + s.remainder() != n || s.remainder() < InfInt::zero || s.remainder() > s.root() + s.root())
+			std::cout << "bug: sqrtrem(" << n << ") = " << s.root() << ", " << s.remainder() << std::endl;
+		InfInt square = n * n;
+		if (InfIntMath::sqrt(square) != n || !InfIntMath::is_perfect_square(square))
+			std::cout << "bug: sqrt(" << square << ") = " << n << " or getting: " << InfIntMath::sqrt(square) << std::endl;
+		if (n > InfInt::pos_one && (InfIntMath::is_perfect_square(square - InfInt::pos_one) || InfIntMath::is_perfect_square(square + InfInt::pos_one)))
+			std::cout << "bug: " << n << "^2 +- 1 is not a square" << std::endl;
+	}
+	std::cout << "Finished testing sqrt and sqrtrem" << std::endl << std::endl;
+
+	std::cout << "Testing nth_root and is_perfect_power ..." << std::endl;
+	const int limit = 5000;
+	std::vector<bool> powers(limit, false);
+	std::vector<bool> odd_powers(limit, false);
+	powers[0] = powers[1] = odd_powers[0] = odd_powers[1] = true;
+	for (int m = 2; m * m < limit; ++m)
+		for (int k = 2, p = m * m; p < limit; ++k, p *= m) {
+			powers[p] = true;
+			if (k % 2)
+				odd_powers[p] = true;
+		}
+	for (int n = 0; n < limit; ++n) {
+		if (InfIntMath::nth_root(n, 1) != n)
+			std::cout << "bug: nth_root(" << n << ", 1) = " << n << " or getting: " << InfIntMath::nth_root(n, 1) << std::endl;
+		for (unsigned long k = 2; k <= 14; ++k) {
+			int r = 0;
+			while (InfIntMath::pow(InfInt(r + 1), InfInt(k)) <= n)
+				++r;
+			if (InfIntMath::nth_root(n, k) != r)
+				std::cout << "bug: nth_root(" << n << ", " << k << ") = " << r << " or getting: " << InfIntMath::nth_root(n, k) << std::endl;
+		}
+		if (InfIntMath::is_perfect_power(n) != powers[n])
+			std::cout << "bug: is_perfect_power(" << n << ") = " << !powers[n] << std::endl;
+		if (InfIntMath::is_perfect_power(-n) != odd_powers[n])
+			std::cout << "bug: is_perfect_power(" << -n << ") = " << !odd_powers[n] << std::endl;
+	}
+	for (int i = 0; i < 21; ++i) {
+		unsigned long k = 2 + i % 7;
+		InfInt m = (rand() >> (384 + i * 13 % 120)) + 2_infint;
+		InfInt n = InfIntMath::pow(m, InfInt(k));
+		if (InfIntMath::nth_root(n, k) != m || InfIntMath::nth_root(n - InfInt::pos_one, k) != m - InfInt::pos_one || InfIntMath::nth_root(n + InfInt::pos_one, k) != m)
+			std::cout << "bug: nth_root(" << n << ", " << k << ") = " << m << " or getting: " << InfIntMath::nth_root(n, k) << std::endl;
+		if (!InfIntMath::is_perfect_power(n) || InfIntMath::is_perfect_power(n * InfIntMath::next_prime(m) * 2_infint))
+			std::cout << "bug: is_perfect_power(" << n << ")" << std::endl;
+	}
+	std::cout << "Finished testing nth_root and is_perfect_power" << std::endl << std::endl;
+
+	std::cout << "Testing ilog and log2_double ..." << std::endl;
+	for (int n = 1; n < 3000; ++n) {
+		for (int base = 2; base < 40; ++base) {
+			InfInt::size_type e = 0;
+			for (int p = base; p <= n; p *= base)
+				++e;
+			if (InfIntMath::ilog(n, base) != e || InfIntMath::log(n, base) != InfInt(e))
+				std::cout << "bug: ilog(" << n << ", " << base << ") = " << e << " or getting: " << InfIntMath::ilog(n, base) << std::endl;
+		}
+		if (InfIntMath::log2_double(n) != std::log2(static_cast<double>(n)))
+			std::cout << "bug: log2_double(" << n << ") = " << std::log2(static_cast<double>(n)) << " or getting: " << InfIntMath::log2_double(n) << std::endl;
+	}
+	const InfInt bases[] = {2, 3, 10, 16, 255, 65536, (InfInt::pos_one << 64) + 13_infint};
+	for (int i = 0; i < 10; ++i) {
+		InfInt n = (rand() >> (i * 37 % 400)) + InfInt::pos_one;
+		for (const InfInt& base : bases) {
+			InfInt::size_type e = 0;
+			for (InfInt p = base; p <= n; p *= base)
+				++e;
+			InfInt power = InfIntMath::pow(base, InfInt(e));
+			if (InfIntMath::ilog(n, base) != e || InfIntMath::ilog(power, base) != e || (e > 0 && InfIntMath::ilog(power - InfInt::pos_one, base) != e - 1))
+				std::cout << "bug: ilog(" << n << ", " << base << ") = " << e << " or getting: " << InfIntMath::ilog(n, base) << std::endl;
+		}
+		double expected = std::log2(std::stod(n.str()));
+		if (std::abs(InfIntMath::log2_double(n) - expected) > 1e-9 || std::abs(InfIntMath::log2_double(n << 100) - expected - 100) > 1e-9)
+			std::cout << "bug: log2_double(" << n << ") = " << expected << " or getting: " << InfIntMath::log2_double(n) << std::endl;
+	}
+	std::cout << "Finished testing ilog and log2_double" << std::endl << std::endl;
+
+	std::cout << "Testing product, factorial, binomial and primorial ..." << std::endl;
+	InfInt naive_factorial = InfInt::pos_one;
+	InfInt naive_primorial = InfInt::pos_one;
+	std::vector<std::uint32_t> factors;
+	for (std::uint32_t n = 0; n < 150; ++n) {
+		if (n > 0)
+			naive_factorial *= InfInt(n);
+		if (InfIntMath::probable_prime(n))
+			naive_primorial *= InfInt(n);
+		if (InfIntMath::factorial(n) != naive_factorial)
+			std::cout << "bug: factorial(" << n << ") = " << naive_factorial << " or getting: " << InfIntMath::factorial(n) << std::endl;
+		if (InfIntMath::primorial(n) != naive_primorial)
+			std::cout << "bug: primorial(" << n << ") = " << naive_primorial << " or getting: " << InfIntMath::primorial(n) << std::endl;
+		for (std::uint32_t k = 0; k <= n; k += 1 + n / 8)
+			if (InfIntMath::binomial(n, k) != naive_factorial / (InfIntMath::factorial(k) * InfIntMath::factorial(n - k)))
+				std::cout << "bug: binomial(" << n << ", " << k << ") = " << InfIntMath::binomial(n, k) << std::endl;
+		factors.push_back(4'000'000'000u - n);
+	}
+	InfInt naive_product = InfInt::pos_one;
+	for (std::uint32_t f : factors)
+		naive_product *= InfInt(f);
+	if (InfIntMath::product(std::span<const std::uint32_t>(factors)) != naive_product)
+		std::cout << "bug: product of " << factors.size() << " factors" << std::endl;
+	factors[factors.size() / 2] = 0;
+	if (InfIntMath::product(std::span<const std::uint32_t>(factors)) != InfInt::zero)
+		std::cout << "bug: product with a zero factor is " << InfIntMath::product(std::span<const std::uint32_t>(factors)) << std::endl;
+	std::cout << "Finished testing product, factorial, binomial and primorial" << std::endl << std::endl;
+
+	std::cout << "Testing remainder_tree and batch_gcd ..." << std::endl;
+	std::vector<InfInt> moduli;
+	for (int i = 0; i < 40; ++i)
+		moduli.push_back((rand() >> (i * 11 % 400)) + 2_infint);
+	InfInt x = rand() * rand();
+	std::vector<InfInt> remainders = InfIntMath::remainder_tree(x, moduli, 3);
+	for (std::size_t i = 0; i < moduli.size(); ++i)
+		if (remainders[i] != x % moduli[i])
+			std::cout << "bug: " << x << " % " << moduli[i] << " = " << x % moduli[i] << " or getting: " << remainders[i] << std::endl;
+	std::vector<InfInt> keys;
+	std::vector<InfInt> key_primes;
+	for (int i = 0; i < 12; ++i)
+		key_primes.push_back(InfIntMath::next_prime(rand() >> 448));
+	for (int i = 0; i < 12; ++i)
+		keys.push_back(key_primes[i] * key_primes[(i * 5 + 1) % 12]); // some keys share a prime
+	keys.push_back(key_primes[0] * key_primes[0]);
+	std::vector<InfInt> gcds = InfIntMath::batch_gcd(keys, 3);
+	for (std::size_t i = 0; i < keys.size(); ++i) {
+		InfInt others = InfInt::pos_one;
+		for (std::size_t j = 0; j < keys.size(); ++j)
+			if (j != i)
+				others *= keys[j];
+		if (gcds[i] != euclid(keys[i], others))
+			std::cout << "bug: batch_gcd[" << i << "] = " << euclid(keys[i], others) << " or getting: " << gcds[i] << std::endl;
+	}
+	std::cout << "Finished testing remainder_tree and batch_gcd" << std::endl << std::endl;
+
+	std::cout << "Testing factor ..." << std::endl;
+	const InfInt semiprime = 1'000'000'007_infint * 998'244'353_infint;
+	const InfInt to_factor[] = {12, -360, 1, InfInt::pos_one << 70, 65537_infint * 65537_infint * 65539_infint, semiprime};
+	for (const InfInt& n : to_factor) {
+		std::map<InfInt, unsigned> factors = InfIntMath::factor(n, 2);
+		InfInt product = InfInt::pos_one;
+		for (const auto& [p, exponent] : factors) {
+			if (p != InfInt::neg_one && !InfIntMath::probable_prime(p))
+				std::cout << "bug: factor(" << n << ") gave the composite " << p << std::endl;
+			product *= InfIntMath::pow(p, InfInt(exponent));
+		}
+		if (product != n)
+			std::cout << "bug: the factors of " << n << " multiply to " << product << std::endl;
+	}
+	// the finders only return proper factors, or zero when they give up
+	auto proper_factor = [](const InfInt& d, const InfInt& n) {
+		return d > InfInt::pos_one && d < n && InfInt::divisible_by(n, d);
+	};
+	const InfInt composites[] = {65537_infint * 65539_infint, 65537_infint * 65537_infint * 65539_infint, semiprime};
+	for (const InfInt& n : composites) {
+		InfInt d = InfIntMath::find_factor(n, 2);
+		if (!proper_factor(d, n))
+			std::cout << "bug: find_factor(" << n << ") = " << d << std::endl;
+		bool found = false;
+		for (int c = 1; c <= 3; ++c) {
+			d = InfIntMath::pollard_brent(n, InfInt(c));
+			if (d != InfInt::zero && !proper_factor(d, n))
+				std::cout << "bug: pollard_brent(" << n << ", " << c << ") = " << d << std::endl;
+			found = found || d != InfInt::zero;
+		}
+		if (!found)
+			std::cout << "bug: pollard_brent found no factor of " << n << std::endl;
+		d = InfIntMath::ecm(n, 2'000, 25, 2);
+		if (!proper_factor(d, n))
+			std::cout << "bug: ecm(" << n << ", 2000, 25) = " << d << std::endl;
+	}
+	// a single curve must never report the trivial factor 1
+	std::vector<std::uint32_t> ecm_primes = InfIntMath::primes_up_to(40'000);
+	for (std::uint32_t sigma = 6; sigma < 40; ++sigma) {
+		InfInt d = InfIntMath::ecm_curve(semiprime, InfInt(sigma), 400, ecm_primes);
+		if (d != InfInt::zero && !proper_factor(d, semiprime))
+			std::cout << "bug: ecm_curve(" << semiprime << ", " << sigma << ") = " << d << std::endl;
+	}
+	// [0]P is the point at infinity (X : 0), [1]P is P
+	InfModInt::Context ecm_context = InfModInt::context(semiprime);
+	InfIntMath::MontgomeryPoint point = {InfModInt(9_infint, ecm_context), InfModInt(InfInt::pos_one, ecm_context)};
+	InfModInt a24(5_infint, ecm_context);
+	if (InfIntMath::ecm_multiply(point, 0, a24)[1].value() != InfInt::zero)
+		std::cout << "bug: ecm_multiply by 0 is not the point at infinity" << std::endl;
+	InfIntMath::MontgomeryPoint once = InfIntMath::ecm_multiply(point, 1, a24);
+	if (once[0].value() != point[0].value() || once[1].value() != point[1].value())
+		std::cout << "bug: ecm_multiply by 1 changed the point" << std::endl;
+	InfIntMath::MontgomeryPoint six = InfIntMath::ecm_multiply(point, 6, a24);
+	InfIntMath::MontgomeryPoint doubled_three = InfIntMath::ecm_double(InfIntMath::ecm_multiply(point, 3, a24), a24);
+	if ((six[0] * doubled_three[1]).value() != (doubled_three[0] * six[1]).value())
+		std::cout << "bug: ecm_multiply by 6 is not twice the multiple by 3" << std::endl;
+	std::cout << "Finished testing factor" << std::endl << std::endl;
+
+	std::cout << "Testing InfIntCRT ..." << std::endl;
+	std::vector<InfInt> crt_moduli = {InfInt::pos_one << 20, InfIntMath::pow(3, 40), 25};
+	for (int i = 0; i < 9; ++i)
+		crt_moduli.push_back(InfIntMath::next_prime(rand() >> (256 + i * 43 % 200)));
+	for (InfIntCRT::Mode mode : {InfIntCRT::garner, InfIntCRT::tree}) {
+		InfIntCRT crt(crt_moduli, mode);
+		InfInt modulus = InfInt::pos_one;
+		for (const InfInt& m : crt_moduli)
+			modulus *= m;
+		if (crt.modulus() != modulus)
+			std::cout << "bug: crt modulus = " << modulus << " or getting: " << crt.modulus() << std::endl;
+		std::vector<InfInt> values;
+		std::vector<std::vector<InfInt>> all_residues;
+		for (int i = 0; i < 6; ++i) {
+			InfInt x = i == 0 ? InfInt::zero : i == 1 ? modulus - InfInt::pos_one : rand() * rand() * rand() % modulus;
+			std::vector<InfInt> residues = crt.residues(x);
+			for (std::size_t j = 0; j < crt_moduli.size(); ++j)
+				if (residues[j] != x % crt_moduli[j])
+					std::cout << "bug: residues(" << x << ")[" << j << "] = " << x % crt_moduli[j] << " or getting: " << residues[j] << std::endl;
+			if (crt.reconstruct(residues) != x)
+				std::cout << "bug: reconstruct(residues(" << x << ")) = " << crt.reconstruct(residues) << std::endl;
+			// any representative of each residue class gives the same value
+			for (std::size_t j = 0; j < crt_moduli.size(); ++j)
+				residues[j] += crt_moduli[j] * InfInt(int(j % 3) - 1);
+			if (crt.reconstruct(residues) != x)
+				std::cout << "bug: reconstruct of shifted residues(" << x << ") = " << crt.reconstruct(residues) << std::endl;
+			values.push_back(x);
+			all_residues.push_back(residues);
+		}
+		if (crt.reconstruct(std::span<const std::vector<InfInt>>(all_residues), 3) != values)
+			std::cout << "bug: parallel reconstruct" << std::endl;
+		try {
+			crt.reconstruct(std::span<const InfInt>(values.data(), 2));
+			std::cout << "bug: reconstruct from 2 residues should throw" << std::endl;
+		} catch (const std::invalid_argument&) {
+		}
+		try {
+			InfIntCRT shared({InfInt(6), InfInt(35), InfInt(10)}, mode);
+			std::cout << "bug: moduli 6, 35, 10 are not coprime" << std::endl;
+		} catch (const std::invalid_argument&) {
+		}
+	}
+	std::cout << "Finished testing InfIntCRT" << std::endl << std::endl;
+
+	std::cout << "Testing InfModInt ..." << std::endl;
+	const InfInt modint_moduli[] = {
+		1, 2, 3, 4, 255, 4294967291ull, 18446744073709551557ull, InfInt::pos_one << 63, InfInt::pos_one << 64,
+		(InfInt::pos_one << 127) - InfInt::pos_one, rand() | InfInt::pos_one, (rand() >> 200) << 3
+	};
+	for (const InfInt& m : modint_moduli) {
+		InfModInt::Context context = InfModInt::context(m);
+		for (int i = 0; i < 6; ++i) {
+			InfInt a = i == 0 ? InfInt::zero : (rand() >> (i * 61 % 400)) - (i % 2 ? m : InfInt::zero);
+			InfInt b = i == 1 ? m - InfInt::pos_one : rand() >> (i * 83 % 500);
+			InfInt e = i < 2 ? InfInt(i) : rand() >> (400 + i * 13 % 100);
+			InfModInt x(a, context);
+			InfModInt y(b, context);
+			if (x.value() != InfIntMath::modulo(a, m))
+				std::cout << "bug: " << a << " mod " << m << " = " << InfIntMath::modulo(a, m) << " or getting: " << x << std::endl;
+			if ((x + y).value() != InfIntMath::modulo(a + b, m))
+				std::cout << "bug: " << a << " + " << b << " mod " << m << " = " << InfIntMath::modulo(a + b, m) << " or getting: " << x + y << std::endl;
+			if ((x - y).value() != InfIntMath::modulo(a - b, m))
+				std::cout << "bug: " << a << " - " << b << " mod " << m << " = " << InfIntMath::modulo(a - b, m) << " or getting: " << x - y << std::endl;
+			if ((x * y).value() != InfIntMath::modulo(a * b, m))
+				std::cout << "bug: " << a << " * " << b << " mod " << m << " = " << InfIntMath::modulo(a * b, m) << " or getting: " << x * y << std::endl;
+			InfInt expected = InfInt::pos_one % m;
+			InfInt square = InfIntMath::modulo(a, m);
+			for (InfInt::size_type j = 0; j < e.size(); ++j, square = square * square % m)
+				if (e.get(j))
+					expected = expected * square % m;
+			if (x.pow(e).value() != expected || x.pow_ladder(e).value() != expected || x.pow_window(e).value() != expected)
+				std::cout << "bug: " << a << "^" << e << " mod " << m << " = " << expected << " or getting: " << x.pow(e) << ", " << x.pow_ladder(e) << ", " << x.pow_window(e) << std::endl;
+			if (euclid(b, m) == InfInt::pos_one) {
+				InfInt inverse = InfIntMath::modinv(InfIntMath::modulo(b, m), m);
+				if (y.inverse().value() != inverse || (x / y).value() != InfIntMath::modulo(a * inverse, m) || y.pow(-e) != y.inverse().pow(e) || y.pow_window(-e) != y.inverse().pow(e))
+					std::cout << "bug: 1 / " << b << " mod " << m << " = " << inverse << " or getting: " << y.inverse() << std::endl;
+			}
+		}
+	}
+	std::cout << "Finished testing InfModInt" << std::endl << std::endl;
+
+	std::cout << "Testing the constant time reduction ..." << std::endl;
+	// one word, where the final subtraction weighs the most in REDC; a branch
+	// on it would be mispredicted about half of the time on the mixed inputs
+	InfInt redc_modulus = (InfInt::pos_one << 31) + 11_infint;
+	RedcProbe probe(redc_modulus);
+	InfInt radix = InfInt::pos_one << 32;
+	InfInt minus_inverse = radix - InfIntMath::modinv(redc_modulus, radix);
+	std::vector<InfModIntContext::words_type> operands[2]; // pairs without and with the subtraction
+	while (operands[0].size() < 512 || operands[1].size() < 512) {
+		InfInt a = rand() % redc_modulus;
+		InfInt b = rand() % redc_modulus;
+		InfInt t = (a * b + a * b * minus_inverse % radix * redc_modulus) / radix;
+		std::size_t k = t >= redc_modulus;
+		InfModIntContext::words_type a_words = a.to_words<InfModIntContext::word_type>();
+		InfModIntContext::words_type b_words = b.to_words<InfModIntContext::word_type>();
+		a_words.resize(1, 0);
+		b_words.resize(1, 0);
+		if (InfInt::from_words(probe.redc(a_words, b_words)) != t % redc_modulus)
+			std::cout << "bug: redc(" << a << ", " << b << ") = " << t % redc_modulus << " or getting: " << InfInt::from_words(probe.redc(a_words, b_words)) << std::endl;
+		if (operands[k].size() < 512) {
+			operands[k].push_back(a_words);
+			operands[k].push_back(b_words);
+		}
+	}
+	std::vector<InfModIntContext::words_type> mixed;
+	for (std::size_t i = 0; i < 512; i += 2) {
+		std::size_t k = rand().get(0);
+		mixed.push_back(operands[k][i]);
+		mixed.push_back(operands[k][i + 1]);
+	}
+	const std::vector<InfModIntContext::words_type>* streams[3] = {&operands[0], &operands[1], &mixed};
+	double best[3] = {1e9, 1e9, 1e9};
+	InfModIntContext::word_type sink = 0;
+	for (int round = 0; round < 15; ++round) {
+		for (int k = 0; k < 3; ++k) {
+			const std::vector<InfModIntContext::words_type>& stream = *streams[k];
+			auto start = std::chrono::steady_clock::now();
+			for (int repeat = 0; repeat < 400; ++repeat)
+				for (std::size_t i = 0; i < stream.size(); i += 2)
+					sink += probe.redc(stream[i], stream[i + 1])[0];
+			std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+			best[k] = std::min(best[k], elapsed.count());
+		}
+	}
+	for (int k = 1; k < 3; ++k)
+		if (best[k] / best[0] < 0.9 || best[k] / best[0] > 1.1)
+			std::cout << "bug: redc takes " << best[k] / best[0] << " times as long on " << (k == 1 ? "inputs that need the subtraction" : "mixed inputs") << " (" << sink % 2 << ")" << std::endl;
+	std::cout << "Finished testing the constant time reduction" << std::endl << std::endl;
+
+	std::cout << "End Math Tests, press entrer to continue... "; std::cin.get();
+	std::cout << std::endl << std::endl << std::endl;
+}
+
+// exposes the CRT exponents, to corrupt one and reach the fault check
+class RSAProbe: public InfIntRSA {
+public:
+	using InfIntRSA::m_exponents;
+};
+
+void rsa_tests(void) {
+	std::cout << "Start RSA Tests" << std::endl << std::endl;
+
+	InfIntRandomEngine rand(64, 47u);
+	std::vector<InfInt> small_primes;
+	for (int i = 0; i < 8; ++i)
+		small_primes.push_back(InfIntMath::random_prime(24 + i % 3, rand));
+
+	std::cout << "Testing e selection ..." << std::endl;
+	const InfInt min_es[] = {2, 3, 4, 17, 255, 65536, 65537, 1'000'000, 4'294'967'290ull, (InfInt::pos_one << 40) + 3_infint};
+	for (std::size_t i = 0; i + 1 < small_primes.size(); ++i) {
+		InfInt p = small_primes[i];
+		InfInt q = small_primes[i + 1];
+		if (p == q)
+			continue;
+		for (const InfInt& min_e : min_es) {
+			for (InfIntRSA::Totient totient : {InfIntRSA::euler, InfIntRSA::carmichael}) {
+				InfInt phi = (p - InfInt::pos_one) * (q - InfInt::pos_one);
+				InfInt e = min_e;
+				while (euclid(e, phi) != InfInt::pos_one)
+					++e;
+				InfIntRSA rsa;
+				rsa.create_keys({p, q}, min_e, totient);
+				if (rsa.e() != e)
+					std::cout << "bug: e for (" << p << ", " << q << ") from " << min_e << " = " << e << " or getting: " << rsa.e() << std::endl;
+			}
+		}
+	}
+	std::cout << "Finished testing e selection" << std::endl << std::endl;
+
+	std::cout << "Testing the Carmichael totient ..." << std::endl;
+	for (std::size_t i = 0; i + 2 < small_primes.size(); ++i) {
+		std::vector<InfInt> primes(small_primes.begin() + i, small_primes.begin() + i + 2 + i % 2);
+		InfInt lambda = InfInt::pos_one;
+		for (const InfInt& r : primes)
+			lambda = lambda * (r - InfInt::pos_one) / euclid(lambda, r - InfInt::pos_one);
+		InfIntRSA euler_rsa;
+		euler_rsa.create_keys(primes);
+		InfIntRSA rsa;
+		rsa.create_keys(primes, InfIntRSA::carmichael);
+		if (rsa.e() != euler_rsa.e() || rsa.n() != euler_rsa.n() || rsa.d() * rsa.e() % lambda != InfInt::pos_one || rsa.d() >= lambda || rsa.d() > euler_rsa.d())
+			std::cout << "bug: carmichael d for n = " << rsa.n() << " is " << rsa.d() << std::endl;
+		// RFC 8017: qInv = q^-1 mod p, then t_i = (r_0 ... r_i-1)^-1 mod r_i
+		const std::vector<InfInt>& coefficients = rsa.coefficients();
+		InfInt prefix = primes[1];
+		for (std::size_t j = 0; j + 1 < primes.size(); ++j) {
+			const InfInt& r = j == 0 ? primes[0] : primes[j + 1];
+			if (coefficients.size() + 1 != primes.size() || coefficients[j] >= r || coefficients[j] * prefix % r != InfInt::pos_one)
+				std::cout << "bug: CRT coefficient " << j << " for n = " << rsa.n() << std::endl;
+			prefix *= j == 0 ? primes[0] : r;
+		}
+		for (int j = 0; j < 4; ++j) {
+			InfInt m = rand() % rsa.n();
+			if (rsa.uncypher(rsa.cypher(m)) != m || rsa.uncypher(euler_rsa.cypher(m)) != m)
+				std::cout << "bug: carmichael round trip of " << m << " modulo " << rsa.n() << std::endl;
+		}
+	}
+	std::cout << "Finished testing the Carmichael totient" << std::endl << std::endl;
+
+	std::cout << "Testing CRT decryption ..." << std::endl;
+	InfIntRandomEngine messages(512, 51u);
+	for (unsigned count : {2u, 3u}) {
+		RSAProbe rsa;
+		rsa.generate_keys(256, count, InfIntRSA::euler, 2);
+		for (int i = 0; i < 6; ++i) {
+			InfInt m = messages() % rsa.n();
+			InfInt c = rsa.cypher(m);
+			InfInt plain = InfIntMath::modpow(c, rsa.d(), rsa.n());
+			if (plain != m || rsa.uncypher(c) != plain || rsa.uncypher(c, count) != plain)
+				std::cout << "bug: CRT decryption of " << c << " with " << count << " primes = " << rsa.uncypher(c) << " or expecting: " << plain << std::endl;
+		}
+		// a wrong exponent for any one prime gives a wrong residue, which the
+		// check against the public key must catch instead of returning it
+		for (std::size_t j = 0; j < count; ++j) {
+			InfInt exponent = rsa.m_exponents[j];
+			rsa.m_exponents[j] += InfInt::pos_one;
+			InfInt c = rsa.cypher(messages() % rsa.n());
+			try {
+				rsa.uncypher(c);
+				std::cout << "bug: uncypher with a corrupted exponent for prime " << j << " of " << count << " should throw" << std::endl;
+			} catch (const std::domain_error&) {
+			}
+			rsa.m_exponents[j] = exponent;
+		}
+	}
+	std::cout << "Finished testing CRT decryption" << std::endl << std::endl;
+
+	std::cout << "Testing batches and partial keys ..." << std::endl;
+	InfIntRSA batch_rsa;
+	batch_rsa.generate_keys(256, 3, InfIntRSA::carmichael, 2);
+	std::vector<InfInt> plains;
+	for (int i = 0; i < 20; ++i)
+		plains.push_back(i < 2 ? InfInt(i) : messages() % batch_rsa.n());
+	std::vector<InfInt> serial_cyphered(plains.size());
+	batch_rsa.encrypt_batch(plains, serial_cyphered, 1);
+	for (unsigned threads : {1u, 3u, 8u}) {
+		std::vector<InfInt> cyphered(plains.size());
+		std::vector<InfInt> decyphered(plains.size());
+		batch_rsa.encrypt_batch(plains, cyphered, threads);
+		batch_rsa.decrypt_batch(cyphered, decyphered, threads);
+		if (cyphered != serial_cyphered || decyphered != plains)
+			std::cout << "bug: batch round trip with " << threads << " threads" << std::endl;
+	}
+
+	// the public half encrypts the same way and has nothing to decrypt with
+	InfIntRSA public_rsa;
+	public_rsa.public_key(batch_rsa.e(), batch_rsa.n());
+	std::vector<InfInt> public_cyphered(plains.size());
+	public_rsa.encrypt_batch(plains, public_cyphered, 3);
+	if (public_rsa.has_private_key() || public_cyphered != serial_cyphered)
+		std::cout << "bug: public key encryption differs from the full key's" << std::endl;
+	try {
+		public_rsa.uncypher(serial_cyphered[2]);
+		std::cout << "bug: uncypher with a public key should throw" << std::endl;
+	} catch (const std::domain_error&) {
+	}
+	try {
+		std::vector<InfInt> ignored(plains.size());
+		public_rsa.decrypt_batch(serial_cyphered, ignored, 3);
+		std::cout << "bug: decrypt_batch with a public key should throw" << std::endl;
+	} catch (const std::domain_error&) {
+	}
+
+	// d and n alone decrypt with one exponentiation modulo n
+	InfIntRSA private_rsa;
+	private_rsa.private_key(batch_rsa.e(), batch_rsa.d(), batch_rsa.n());
+	std::vector<InfInt> private_decyphered(plains.size());
+	private_rsa.decrypt_batch(serial_cyphered, private_decyphered, 3);
+	if (!private_rsa.has_private_key() || !private_rsa.primes().empty() || private_decyphered != plains)
+		std::cout << "bug: decryption with a key without its primes" << std::endl;
+	std::cout << "Finished testing batches and partial keys" << std::endl << std::endl;
+
+	std::cout << "Testing stream encryption ..." << std::endl;
+	InfIntRSA stream_rsa;
+	stream_rsa.generate_keys(256, 2, InfIntRSA::euler, 2);
+	std::size_t plain = stream_rsa.plain_block();
+	std::string embedded("line\n\0\0end\xff", 12);
+	const std::string texts[] = {
+		"",
+		"a",
+		std::string(plain * 3, 'x'),
+		std::string("\0\0leading zeros", 15),
+		embedded + std::string(plain * InfIntRSA::stream_blocks, '\n') + embedded
+	};
+	for (const std::string& text : texts) {
+		std::istringstream plain_in(text);
+		std::ostringstream cyphered_out;
+		stream_rsa.encrypt_stream(plain_in, cyphered_out, 2);
+		std::string cyphered = cyphered_out.str();
+		if (cyphered.size() != (text.size() + plain - 1) / plain * stream_rsa.cypher_block())
+			std::cout << "bug: " << text.size() << " bytes encrypted to " << cyphered.size() << " bytes" << std::endl;
+		std::istringstream cyphered_in(cyphered);
+		std::ostringstream plain_out;
+		stream_rsa.decrypt_stream(cyphered_in, plain_out, 2);
+		if (plain_out.str() != text)
+			std::cout << "bug: stream round trip of " << text.size() << " bytes gives " << plain_out.str().size() << " bytes" << std::endl;
+		if (cyphered.empty())
+			continue;
+		try {
+			std::istringstream truncated(cyphered.substr(0, cyphered.size() - 1));
+			std::ostringstream ignored;
+			stream_rsa.decrypt_stream(truncated, ignored, 2);
+			std::cout << "bug: a truncated block should throw" << std::endl;
+		} catch (const std::invalid_argument&) {
+		}
+	}
+	std::cout << "Finished testing stream encryption" << std::endl << std::endl;
+
+	std::cout << "End RSA Tests, press entrer to continue... "; std::cin.get();
+	std::cout << std::endl << std::endl << std::endl;
+}
+
+double benchmark(const std::string& name, int runs, const std::function<void(void)>& f) {
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < runs; ++i)
+		f();
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	double ms = elapsed.count() / runs;
+	std::cout << name << ": " << ms << " ms" << std::endl;
+	return ms;
+}
+
+void benchmarks(void) {
+	std::cout << "Start Benchmarks" << std::endl << std::endl;
+
+	InfIntRandomEngine rand(256);
+	InfInt m = rand();
+	if (!m.get(0)) ++m;
+	InfInt a = rand() % m;
+	InfInt b = rand() % m;
+
+	// the constant time paths against the variable time one; RSA decryption
+	// uses the windowed one, the budget is 1.15
+	double fast = benchmark("modpow", 50, [&]() { InfIntMath::modpow(a, b, m); });
+	double ladder = benchmark("modpow_ladder", 50, [&]() { InfIntMath::modpow_ladder(a, b, m); });
+	double window = benchmark("modpow_window", 50, [&]() { InfIntMath::modpow_window(a, b, m); });
+	std::cout << "ladder / modpow: " << ladder / fast << std::endl;
+	std::cout << "window / modpow: " << window / fast << std::endl << std::endl;
+
+	std::cout << "End Benchmarks, press entrer to continue... "; std::cin.get();
+	std::cout << std::endl << std::endl << std::endl;
+}